@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "src/trie.hpp"
+#include "src/journal.hpp"
+#include "src/concurrent_trie.hpp"
+#include "src/olc_trie.hpp"
+
+// Rough throughput numbers, not a rigorous benchmark suite.
+// Node layouts are compared by building twice, e.g.:
+//   g++ -std=c++20 -O2 bench.cpp -o bench
+//   g++ -std=c++20 -O2 -DLTR_NO_CHILD_INDEX bench.cpp -o bench_list
+// and the child search the same way with -DLTR_NO_SIMD, or -mavx2 for the wider blocks
+
+const auto& concat = [](std::string& Seq, char C)
+-> std::string& {
+    Seq.push_back(C);
+    return Seq;
+};
+
+using namespace ltr;
+using default_trie = trie<char, int, decltype(concat)>;
+using compressed_trie = trie<char, int, decltype(concat), std::less, std::basic_string,
+                             std::char_traits, std::allocator, path_compression>;
+using implicit_trie = trie<char, int, decltype(concat), std::less, std::basic_string,
+                           std::char_traits, std::allocator, path_compression | implicit_keys>;
+
+// keeps results observable so the measured loops aren't optimized away
+std::size_t sink = 0;
+
+template<typename F>
+void Measure(const char* name, std::size_t ops, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::cout << std::left << std::setw(28) << name
+              << std::right << std::setw(10) << std::fixed << std::setprecision(1) << ns / 1e6 << " ms"
+              << std::setw(10) << ns / ops << " ns/op\n";
+}
+
+// keys drawn from the whole byte range give the high fanout the child index targets,
+// smaller alphabets keep the nodes in the sorted stage of the index
+std::vector<std::string> RandomKeys(std::size_t count, std::size_t length, unsigned seed, int alphabet = 256) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> byte(0, alphabet - 1);
+    std::vector<std::string> keys(count);
+    for (std::string& key : keys) {
+        key.resize(length);
+        for (char& c : key)
+            c = static_cast<char>(byte(gen));
+    }
+    return keys;
+}
+
+// url-like keys share long prefixes and end in long unbranched tails
+std::vector<std::string> UrlKeys(std::size_t count, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<std::string> keys(count);
+    for (std::string& key : keys) {
+        key = "https://host" + std::to_string(gen() % 16) + ".example.com/section/" + std::to_string(gen() % 64)
+            + "/items/" + std::to_string(gen()) + "/attachments/original/full-resolution.png";
+    }
+    return keys;
+}
+
+template<typename Trie>
+void BenchKeys(const std::vector<std::string>& keys, const std::vector<std::string>& misses) {
+    const std::size_t count = keys.size();
+    Trie trie(concat);
+
+    Measure("insert", count, [&] {
+        for (std::size_t i = 0; i < count; ++i)
+            trie.emplace(keys[i], static_cast<int>(i));
+    });
+    Measure("find (hit)", count, [&] {
+        for (const std::string& key : keys)
+            sink += trie.find(key)->second;
+    });
+    Measure("find (miss)", count, [&] {
+        for (const std::string& key : misses)
+            sink += trie.contains(key);
+    });
+    const std::vector<std::string_view> views(keys.begin(), keys.end());
+    Measure("find (string_view)", count, [&] {
+        for (std::string_view view : views)
+            sink += trie.find(view)->second;
+    });
+    std::vector<typename Trie::iterator> found;
+    found.reserve(count);
+    Measure("find_many (hit)", count, [&] {
+        trie.find_many(keys, std::back_inserter(found));
+        for (auto it : found)
+            sink += it->second;
+    });
+    std::vector<char> contained(count);
+    Measure("contains_many (miss)", count, [&] {
+        trie.contains_many(misses, contained.begin());
+        for (char c : contained)
+            sink += c;
+    });
+    Measure("iterate", count, [&] {
+        for (const auto& [key, value] : trie)
+            sink += value;
+    });
+    Trie copy(concat);
+    Measure("copy", count, [&] {
+        copy = trie;
+    });
+    Measure("destroy copy", count, [&] {
+        copy.clear();
+    });
+    Measure("rank", count, [&] {
+        for (const std::string& key : misses)
+            sink += trie.rank(key);
+    });
+    Measure("select", count, [&] {
+        for (std::size_t i = 0; i < count; ++i)
+            sink += trie.select(i * 7919 % count)->second;
+    });
+    Measure("longest_prefix_match", count, [&] {
+        for (const std::string& key : misses)
+            sink += trie.longest_prefix_match(key) != trie.end();
+    });
+    Measure("fuzzy_search (distance 1)", count / 100, [&] {
+        std::vector<std::pair<decltype(trie.cbegin()), std::size_t>> found;
+        for (std::size_t i = 0; i < count / 100; ++i)
+            std::as_const(trie).fuzzy_search(keys[i], 1, std::back_inserter(found));
+        sink += found.size();
+    });
+    // the keys with their middle fragment left open, escaped since random keys hold any byte
+    std::vector<ltr::pattern> patterns;
+    for (std::size_t i = 0; i < count / 100; ++i) {
+        std::string source;
+        for (std::size_t j = 0; j < keys[i].size(); ++j) {
+            if (j == keys[i].size() / 2)
+                source += '.';
+            else
+                source.append({ '\\', keys[i][j] });
+        }
+        patterns.emplace_back(source);
+    }
+    Measure("match (one open fragment)", patterns.size(), [&] {
+        std::vector<decltype(trie.cbegin())> found;
+        for (const ltr::pattern& pattern : patterns)
+            std::as_const(trie).match(pattern, std::back_inserter(found));
+        sink += found.size();
+    });
+    Measure("freeze", count, [&] {
+        sink += trie.freeze().size();
+    });
+    const auto frozen = trie.freeze();
+    Measure("find (frozen, hit)", count, [&] {
+        for (const std::string& key : keys)
+            sink += frozen.find(key)->second;
+    });
+    Measure("find (frozen, miss)", count, [&] {
+        for (const std::string& key : misses)
+            sink += frozen.contains(key);
+    });
+    Measure("iterate (frozen)", count, [&] {
+        for (const auto& [key, value] : frozen)
+            sink += value;
+    });
+    std::cout << std::left << std::setw(28) << "frozen size" << std::right << std::setw(10)
+              << frozen.memory_size() / 1024 << " KiB" << std::setw(10) << std::fixed << std::setprecision(1)
+              << double(frozen.memory_size()) / count << " B/elem\n";
+    Measure("erase", count, [&] {
+        for (const std::string& key : keys)
+            sink += trie.erase(key);
+    });
+    // refill, reusing the recycled nodes
+    Measure("insert (after erase)", count, [&] {
+        for (std::size_t i = 0; i < count; ++i)
+            trie.emplace(keys[i], static_cast<int>(i));
+    });
+    Measure("clear", count, [&] {
+        trie.clear();
+    });
+
+    // sorted input, one element at a time and as a range appended along the rightmost path
+    std::vector<std::pair<std::string, int>> sorted;
+    for (std::size_t i = 0; i < count; ++i)
+        sorted.emplace_back(keys[i], static_cast<int>(i));
+    std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+        return std::lexicographical_compare(lhs.first.begin(), lhs.first.end(), rhs.first.begin(), rhs.first.end(), std::less<char>());
+    });
+    Measure("insert (sorted, emplace)", count, [&] {
+        for (const auto& elem : sorted)
+            trie.emplace(elem);
+    });
+    trie.clear();
+    Measure("insert (sorted, range)", count, [&] {
+        trie.insert(sorted.begin(), sorted.end());
+    });
+    sink += trie.size();
+    trie.clear();
+    Measure("insert (sorted, end hint)", count, [&] {
+        for (const auto& elem : sorted)
+            trie.insert(trie.end(), elem);
+    });
+    trie.clear();
+    Measure("insert (sorted, last hint)", count, [&] {
+        auto hint = trie.end();
+        for (const auto& elem : sorted)
+            hint = trie.insert(hint, elem);
+    });
+    sink += trie.size();
+
+    // combining two halves, element by element and by relinking subtrees
+    Trie evens(concat), odds(concat);
+    for (std::size_t i = 0; i < count; ++i)
+        (i % 2 ? odds : evens).emplace(keys[i], static_cast<int>(i));
+    Trie combined = evens;
+    Measure("emplace (other half)", count / 2, [&] {
+        for (const auto& [key, value] : odds)
+            combined.emplace(key, value);
+    });
+    Measure("merge (other half)", count / 2, [&] {
+        evens.merge(odds);
+    });
+    Measure("extract + insert", count, [&] {
+        for (const std::string& key : keys)
+            sink += evens.insert(evens.extract(key)).inserted;
+    });
+    sink += combined.size() + evens.size();
+}
+
+void BenchLayout(std::size_t count, std::size_t length, int alphabet = 256) {
+    std::cout << "-- " << count << " random keys of length " << length << " over " << alphabet << " bytes --\n";
+    BenchKeys<default_trie>(RandomKeys(count, length, 42, alphabet), RandomKeys(count, length, 4242, alphabet));
+}
+
+void BenchCompression(std::size_t count) {
+    const std::vector<std::string> keys = UrlKeys(count, 42);
+    const std::vector<std::string> misses = UrlKeys(count, 4242);
+    std::cout << "-- " << count << " url keys, uncompressed --\n";
+    BenchKeys<default_trie>(keys, misses);
+    std::cout << "-- " << count << " url keys, path compressed --\n";
+    BenchKeys<compressed_trie>(keys, misses);
+    std::cout << "-- " << count << " url keys, path compressed, implicit keys --\n";
+    BenchKeys<implicit_trie>(keys, misses);
+}
+
+// startup from an image compared to inserting the keys again
+void BenchImage(std::size_t count) {
+    std::cout << "-- " << count << " url keys, image --\n";
+    const std::vector<std::string> keys = UrlKeys(count, 42);
+    compressed_trie trie(concat);
+    Measure("rebuild (insert)", count, [&] {
+        for (std::size_t i = 0; i < count; ++i)
+            trie.emplace(keys[i], static_cast<int>(i));
+    });
+    std::ostringstream out;
+    Measure("write image", count, [&] {
+        trie.freeze().write(out);
+    });
+    const std::string bytes = out.str();
+    std::vector<std::uint64_t> buffer((bytes.size() + 7) / 8);
+    std::memcpy(buffer.data(), bytes.data(), bytes.size());
+    const std::span<const std::byte> image(reinterpret_cast<const std::byte*>(buffer.data()), bytes.size());
+    Measure("open image", 1, [&] {
+        sink += frozen_trie<char, int, decltype(concat)>(image, concat).size();
+    });
+    const frozen_trie<char, int, decltype(concat)> viewed(image, concat);
+    Measure("contains (image)", count, [&] {
+        for (const std::string& key : keys)
+            sink += viewed.contains(key);
+    });
+    std::cout << std::left << std::setw(28) << "image size" << std::right << std::setw(10)
+              << bytes.size() / 1024 << " KiB\n";
+}
+
+// logging changes with a sync per group of records, and recovering from the log
+void BenchJournal(std::size_t count) {
+    std::cout << "-- " << count << " url keys, journal --\n";
+    const std::vector<std::string> keys = UrlKeys(count, 42);
+    const std::string path = (std::filesystem::temp_directory_path() / "ltr_bench_journal.bin").string();
+    std::filesystem::remove(path);
+    {
+        compressed_trie trie(concat);
+        journal<compressed_trie> log(trie, path, 256);
+        Measure("insert (journaled)", count, [&] {
+            for (std::size_t i = 0; i < count; ++i)
+                log.insert({ keys[i], static_cast<int>(i) });
+            log.commit();
+        });
+        Measure("compact", count, [&] {
+            log.compact();
+        });
+    }
+    compressed_trie trie(concat);
+    Measure("replay (compacted)", count, [&] {
+        journal<compressed_trie> log(trie, path);
+        sink += trie.size();
+    });
+    std::filesystem::remove(path);
+}
+
+// lookups pinning the published trie, alone and from every core while the writer publishes batches
+void BenchConcurrentReads(std::size_t count) {
+    std::cout << "-- " << count << " url keys, concurrent readers --\n";
+    const std::vector<std::string> keys = UrlKeys(count, 42);
+    concurrent_trie<compressed_trie> shared(concat);
+    Measure("insert + publish (x100)", count, [&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            shared.insert({ keys[i], static_cast<int>(i) });
+            if (i % 100 == 99)
+                shared.publish();
+        }
+        shared.publish();
+    });
+    Measure("find (pinned per lookup)", count, [&] {
+        for (const std::string& key : keys)
+            sink += shared.read()->find(key)->second;
+    });
+    const std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    Measure("find (all cores, writing)", count * threads, [&] {
+        std::vector<std::thread> readers;
+        std::vector<std::size_t> sums(threads);
+        for (std::size_t t = 0; t < threads; ++t) {
+            readers.emplace_back([&, t] {
+                for (const std::string& key : keys)
+                    sums[t] += shared.read()->contains(key);
+            });
+        }
+        for (std::size_t i = 0; i < count; i += 10) {
+            shared.insert_or_assign(keys[i], 0);
+            if (i % 1000 == 0)
+                shared.publish();
+        }
+        shared.publish();
+        for (std::size_t t = 0; t < threads; ++t) {
+            readers[t].join();
+            sink += sums[t];
+        }
+    });
+}
+
+// threads inserting disjoint shares of the keys and then finding all of them, at 1 up to N threads
+void BenchWriterScaling(std::size_t count) {
+    std::cout << "-- " << count << " random keys of length 8, threads inserting --\n";
+    const std::vector<std::string> keys = RandomKeys(count, 8, 42);
+    std::vector<std::pair<std::string, int>> elems;
+    for (std::size_t i = 0; i < count; ++i)
+        elems.emplace_back(keys[i], static_cast<int>(i));
+    const std::size_t most = std::max<std::size_t>(4, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= most; threads *= 2) {
+        olc_trie<char, int, decltype(concat)> trie(concat);
+        auto run = [&](auto&& work) {
+            std::vector<std::thread> workers;
+            for (std::size_t t = 0; t < threads; ++t)
+                workers.emplace_back(work, t);
+            for (std::thread& worker : workers)
+                worker.join();
+        };
+        const std::string insert_name = "try_insert (" + std::to_string(threads) + " threads)";
+        Measure(insert_name.c_str(), count, [&] {
+            run([&](std::size_t t) {
+                for (std::size_t i = t; i < count; i += threads)
+                    trie.try_emplace(keys[i], static_cast<int>(i));
+            });
+        });
+        const std::string find_name = "find (" + std::to_string(threads) + " threads)";
+        Measure(find_name.c_str(), count, [&] {
+            run([&](std::size_t t) {
+                std::size_t sum = 0;
+                for (std::size_t i = t; i < count; i += threads)
+                    sum += *trie.find(keys[i]);
+                sink += sum;
+            });
+        });
+        default_trie built(concat);
+        const std::string parallel_name = "parallel_insert (" + std::to_string(threads) + " threads)";
+        Measure(parallel_name.c_str(), count, [&] {
+            built.parallel_insert(elems.begin(), elems.end(), threads);
+        });
+        sink += built.size();
+    }
+}
+
+void BenchTraversalScaling(std::size_t count) {
+    std::cout << "-- " << count << " random keys of length 8, threads traversing --\n";
+    const std::vector<std::string> keys = RandomKeys(count, 8, 42);
+    default_trie trie(concat);
+    for (std::size_t i = 0; i < count; ++i)
+        trie.insert({ keys[i], static_cast<int>(i) });
+    Measure("iterate", count, [&] {
+        long long sum = 0;
+        for (const auto& [key, value] : trie)
+            sum += value;
+        sink += static_cast<std::size_t>(sum);
+    });
+    const std::size_t most = std::max<std::size_t>(4, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= most; threads *= 2) {
+        const std::string name = "parallel_reduce (" + std::to_string(threads) + " threads)";
+        Measure(name.c_str(), count, [&] {
+            sink += static_cast<std::size_t>(trie.parallel_reduce(0ll, std::plus<>(), [](const auto& elem) { return static_cast<long long>(elem.second); }, threads));
+        });
+    }
+}
+
+int main() {
+#ifdef LTR_NO_CHILD_INDEX
+    std::cout << "layout: sibling lists only\n";
+#else
+    std::cout << "layout: adaptive child index\n";
+#endif
+    BenchLayout(200000, 4);
+    BenchLayout(200000, 16);
+    BenchLayout(200000, 6, 40);
+    BenchCompression(100000);
+    BenchImage(100000);
+    BenchJournal(100000);
+    BenchConcurrentReads(100000);
+    BenchWriterScaling(200000);
+    BenchTraversalScaling(200000);
+    std::cout << "(" << sink << ")\n";
+    return 0;
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#ifndef LTR_ARENA
+#define LTR_ARENA
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace ltr {
+
+// per-trie node storage, nodes are carved from slabs of growing size
+// and destroyed nodes are recycled through a free list
+// memory is only given back by release, which frees every slab at once
+// slabs are reference counted, so tries can share them once nodes moved from one to the other,
+// and kept sorted by address, so the slab holding a node is found by a binary search
+template<typename N,	// associated node type
+         template<typename T> typename Alloc>
+class _Node_arena {
+private:
+	// a free slot's memory holds the link to the next free slot
+	union _Slot {
+		_Slot* next;
+		alignas(N) unsigned char storage[sizeof(N)];
+	};
+
+	using slot_allocator = Alloc<_Slot>;
+	using slot_traits    = std::allocator_traits<slot_allocator>;
+
+	struct _Slab_deleter {
+		void operator()(_Slot* slab) const noexcept {
+			slot_allocator alloc;
+			slot_traits::deallocate(alloc, slab, size);
+		}
+
+		std::size_t size;
+	};
+
+	using slab_type      = std::pair<std::shared_ptr<_Slot>, std::size_t>;
+
+public:
+	static constexpr std::size_t min_slab = 64;
+	static constexpr std::size_t max_slab = 65536;
+
+	_Node_arena() noexcept : free(nullptr), cursor(nullptr), limit(nullptr), live(0), grown(0) {}
+	_Node_arena(const _Node_arena& other) = delete;
+	_Node_arena(_Node_arena&& other) noexcept : _Node_arena() { swap(other); }
+	_Node_arena& operator=(const _Node_arena& other) = delete;
+	_Node_arena& operator=(_Node_arena&& other) = delete;
+
+	// nodes must have been destroyed by then
+	~_Node_arena() {
+		release();
+	}
+
+	template<typename... Args>
+	N* create(Args&&... args) {
+		_Slot* slot = take();
+		try {
+			N* node = ::new (static_cast<void*>(slot->storage)) N(std::forward<Args>(args)...);
+			++live;
+			return node;
+		}
+		catch (...) {
+			give_back(slot);
+			throw;
+		}
+	}
+
+	// destroys the node and recycles its memory for later nodes
+	void destroy(N* node) noexcept {
+		node->~N();
+		--live;
+		give_back(reinterpret_cast<_Slot*>(node));
+	}
+
+	// destroys the node without recycling its memory, for teardown followed by release
+	void discard(N* node) noexcept {
+		node->~N();
+		--live;
+	}
+
+	// number of nodes created and not destroyed yet
+	std::size_t size() const noexcept {
+		return live;
+	}
+
+	// makes sure the next count nodes are carved from the current slab without growing in between,
+	// a bigger slab than max_slab is taken if needed
+	void reserve(std::size_t count) {
+		if (static_cast<std::size_t>(limit - cursor) < count)
+			grow(count);
+	}
+
+	// frees every slab no other arena shares, every node carved from them must be destroyed or discarded already
+	// or belong to an arena sharing the slab
+	void release() noexcept {
+		slabs.clear();
+		free = cursor = limit = nullptr;
+		live = grown = 0;
+	}
+
+	// takes over the slabs of other along with its nodes, other is left empty
+	// the slots other never used go to the free list
+	void adopt(_Node_arena& other) {
+		std::size_t owned = slabs.size();
+		slabs.insert(slabs.end(), other.slabs.begin(), other.slabs.end());
+		std::inplace_merge(slabs.begin(), slabs.begin() + owned, slabs.end(), _Slab_order());
+		grown = std::max(grown, other.grown);
+		for (_Slot* slot = other.cursor; slot != other.limit; ++slot)
+			give_back(slot);
+		for (_Slot* slot = other.free; slot != nullptr;) {
+			_Slot* next = slot->next;
+			give_back(slot);
+			slot = next;
+		}
+		live += other.live;
+		other.slabs.clear();
+		other.free = other.cursor = other.limit = nullptr;
+		other.live = other.grown = 0;
+	}
+
+	// shares the slab of other holding node, so the node can move over and outlive other
+	// the slab's other slots stay with other, which recycles them as long as it lives
+	void share(const _Node_arena& other, const N* node) {
+		auto slab = other.holding(reinterpret_cast<const _Slot*>(node));
+		if (slab != other.slabs.end())
+			insert(*slab);
+	}
+
+	// counts count nodes of other as this arena's, their slabs must be shared already
+	void take_over(_Node_arena& other, std::size_t count) noexcept {
+		live += count;
+		other.live -= count;
+	}
+
+	// the slab holding node, kept alive by the returned pointer, node no longer counts as this arena's
+	// its slot isn't recycled by this arena anymore
+	std::shared_ptr<void> lease(const N* node) noexcept {
+		auto slab = holding(reinterpret_cast<const _Slot*>(node));
+		if (slab == slabs.end())
+			return nullptr;
+		--live;
+		return slab->first;
+	}
+
+	// counts a node leased from any arena as this arena's, sharing its slab
+	void attach(const std::shared_ptr<void>& leased) {
+		std::shared_ptr<_Slot> slab = std::static_pointer_cast<_Slot>(leased);
+		std::size_t size = std::get_deleter<_Slab_deleter>(slab)->size;
+		insert(slab_type(std::move(slab), size));
+		++live;
+	}
+
+	constexpr void swap(_Node_arena& other) noexcept {
+		slabs.swap(other.slabs);
+		std::swap(free, other.free);
+		std::swap(cursor, other.cursor);
+		std::swap(limit, other.limit);
+		std::swap(live, other.live);
+		std::swap(grown, other.grown);
+	}
+
+private:
+	struct _Slab_order {
+		bool operator()(const slab_type& lhs, const slab_type& rhs) const noexcept {
+			return std::less<const _Slot*>()(lhs.first.get(), rhs.first.get());
+		}
+
+		bool operator()(const _Slot* slot, const slab_type& slab) const noexcept {
+			return std::less<const _Slot*>()(slot, slab.first.get());
+		}
+	};
+
+	// the slab slot was carved from, slabs.end() if it's none of this arena's
+	auto holding(const _Slot* slot) const noexcept {
+		auto slab = std::upper_bound(slabs.begin(), slabs.end(), slot, _Slab_order());
+		if (slab == slabs.begin() || !std::less<const _Slot*>()(slot, std::prev(slab)->first.get() + std::prev(slab)->second))
+			return slabs.end();
+		return std::prev(slab);
+	}
+
+	// adds the slab unless it's already there
+	void insert(slab_type slab) {
+		auto pos = std::lower_bound(slabs.begin(), slabs.end(), slab, _Slab_order());
+		if (pos == slabs.end() || pos->first != slab.first)
+			slabs.insert(pos, std::move(slab));
+	}
+
+	_Slot* take() {
+		if (free) {
+			_Slot* slot = free;
+			free = free->next;
+			return slot;
+		}
+		if (cursor == limit)
+			grow();
+		return cursor++;
+	}
+
+	void give_back(_Slot* slot) noexcept {
+		slot->next = free;
+		free = slot;
+	}
+
+	// every slab doubles the previous one up to max_slab slots, or holds at least count slots
+	void grow(std::size_t count = 0) {
+		std::size_t size = grown == 0 ? min_slab : std::min(grown * 2, max_slab);
+		size = std::max(size, count);
+		slot_allocator alloc;
+		_Slot* slab = slot_traits::allocate(alloc, size);
+		// the owner frees the slab if it can't be stored
+		std::shared_ptr<_Slot> owner(slab, _Slab_deleter{ size }, alloc);
+		insert(slab_type(std::move(owner), size));
+		grown = size;
+		cursor = slab;
+		limit = slab + size;
+	}
+
+	std::vector<slab_type, Alloc<slab_type>> slabs;
+	_Slot* free;	// head of the free list
+	_Slot* cursor;	// next never used slot of the last slab
+	_Slot* limit;
+	std::size_t live;
+	std::size_t grown;	// size of the last slab carved, the next one doubles it
+
+}; // class _Node_arena
+
+} // namespace ltr
+
+#endif // LTR_ARENA
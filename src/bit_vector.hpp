@@ -0,0 +1,232 @@
+#pragma once
+
+#ifndef LTR_BIT_VECTOR
+#define LTR_BIT_VECTOR
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <array>
+#include <span>
+#include <bit>
+
+namespace ltr {
+
+// read-only bit vector with rank and select support over words stored elsewhere
+// rank is answered from the count of ones in front of every 512 bit block,
+// select by a binary search over those counts followed by a scan of the block's words,
+// the search only covers the blocks between the samples taken every 512 ones and zeros
+class _Bit_view {
+public:
+	static constexpr std::size_t block_words = 8;
+	static constexpr std::size_t block_bits  = block_words * 64;
+
+	using section_type = std::span<const std::uint64_t>;
+
+	_Bit_view() noexcept : bits(0) {}
+	_Bit_view(section_type words, section_type blocks, section_type ones_samples, section_type zeros_samples, std::size_t bits) noexcept
+		: words(words), blocks(blocks), ones_samples(ones_samples), zeros_samples(zeros_samples), bits(bits) {}
+
+	std::size_t size() const noexcept {
+		return bits;
+	}
+
+	bool operator[](std::size_t pos) const noexcept {
+		return (words[pos / 64] >> (pos % 64)) & 1;
+	}
+
+	// number of ones in [0, pos)
+	std::size_t rank1(std::size_t pos) const noexcept {
+		std::size_t word = pos / 64;
+		std::size_t rank = blocks[pos / block_bits];
+		for (std::size_t i = word / block_words * block_words; i < word; ++i)
+			rank += std::popcount(words[i]);
+		if (pos % 64)
+			rank += std::popcount(words[word] & ((std::uint64_t(1) << (pos % 64)) - 1));
+		return rank;
+	}
+
+	std::size_t rank0(std::size_t pos) const noexcept {
+		return pos - rank1(pos);
+	}
+
+	// position of the one with rank n, n has to be less than the number of ones
+	std::size_t select1(std::size_t n) const noexcept {
+		return select<true>(n);
+	}
+
+	// position of the zero with rank n, n has to be less than the number of zeros
+	std::size_t select0(std::size_t n) const noexcept {
+		return select<false>(n);
+	}
+
+	// position of the first bit at or after pos equal to bit, size() if there's none
+	template<bool bit>
+	std::size_t next(std::size_t pos) const noexcept {
+		while (pos < bits) {
+			std::uint64_t word = (bit ? words[pos / 64] : ~words[pos / 64]) >> (pos % 64);
+			if (word) {
+				pos += std::countr_zero(word);
+				return std::min(pos, bits);
+			}
+			pos = (pos / 64 + 1) * 64;
+		}
+		return bits;
+	}
+
+	// the words, the rank directory and the select samples, in the order the constructor takes them
+	std::array<section_type, 4> sections() const noexcept {
+		return { words, blocks, ones_samples, zeros_samples };
+	}
+
+	// bytes taken by the bits, the rank directory and the select samples
+	std::size_t memory_size() const noexcept {
+		return (words.size() + blocks.size() + ones_samples.size() + zeros_samples.size()) * sizeof(std::uint64_t);
+	}
+
+	// whether the sections agree with each other, checked before views of untrusted images are queried:
+	// the words hold bits bits with the rest zero, the directory holds the ones in front of every block and in total,
+	// and every sample is the block holding its rank, which keeps rank and select within the sections
+	bool valid() const noexcept {
+		std::size_t block_count = (words.size() + block_words - 1) / block_words;
+		if (words.size() != (bits + 63) / 64 || blocks.size() != block_count + 1 || (bits % 64 && words.back() >> (bits % 64)))
+			return false;
+		std::uint64_t ones = 0;
+		for (std::size_t i = 0; i < words.size(); ++i) {
+			if (i % block_words == 0 && blocks[i / block_words] != ones)
+				return false;
+			ones += std::popcount(words[i]);
+		}
+		return blocks.back() == ones && valid_samples<true>(ones_samples, ones, block_count) &&
+		       valid_samples<false>(zeros_samples, bits - ones, block_count);
+	}
+
+private:
+	template<bool bit>
+	std::size_t count(std::size_t block) const noexcept {
+		return bit ? blocks[block] : block * block_bits - blocks[block];
+	}
+
+	// a sample per block_bits bits among total, closed by the number of blocks, like _Bit_vector takes them
+	template<bool bit>
+	bool valid_samples(section_type samples, std::size_t total, std::size_t block_count) const noexcept {
+		std::size_t sampled = (total + block_bits - 1) / block_bits;
+		if (samples.size() != sampled + 1 || samples.back() != block_count)
+			return false;
+		for (std::size_t k = 0; k < sampled; ++k) {
+			std::uint64_t block = samples[k];
+			if (block >= block_count || count<bit>(block) > k * block_bits ||
+			    (block + 1 < block_count && count<bit>(block + 1) <= k * block_bits))
+				return false;
+		}
+		return true;
+	}
+
+	template<bool bit>
+	std::size_t select(std::size_t n) const noexcept {
+		// last block with less than n + 1 bits in front of it, the final entry of the directory is never taken
+		section_type samples = bit ? ones_samples : zeros_samples;
+		std::size_t low = samples[n / block_bits];
+		std::size_t high = samples[n / block_bits + 1] + 1;
+		while (high - low > 1) {
+			std::size_t mid = (low + high) / 2;
+			if (count<bit>(mid) <= n)
+				low = mid;
+			else
+				high = mid;
+		}
+		n -= count<bit>(low);
+		for (std::size_t i = low * block_words;; ++i) {
+			std::uint64_t word = bit ? words[i] : ~words[i];
+			std::size_t ones = std::popcount(word);
+			if (n < ones) {
+				for (; n > 0; --n)
+					word &= word - 1;
+				return i * 64 + std::countr_zero(word);
+			}
+			n -= ones;
+		}
+	}
+
+	section_type words;
+	section_type blocks;		// ones in front of every block
+	section_type ones_samples;	// block holding the one of every block_bits-th rank
+	section_type zeros_samples;
+	std::size_t bits;
+
+}; // class _Bit_view
+
+// append only bit vector, built once and then only queried through its view
+template<template<typename T> typename Alloc>
+class _Bit_vector {
+public:
+	static constexpr std::size_t block_words = _Bit_view::block_words;
+	static constexpr std::size_t block_bits  = _Bit_view::block_bits;
+
+	_Bit_vector() noexcept : bits(0) {}
+
+	std::size_t size() const noexcept {
+		return bits;
+	}
+
+	void push_back(bool bit) {
+		if (bits % 64 == 0)
+			words.push_back(0);
+		if (bit)
+			words.back() |= std::uint64_t(1) << (bits % 64);
+		++bits;
+	}
+
+	// builds the rank directory and the select samples, has to be called once the last bit is pushed
+	void build() {
+		blocks.clear();
+		blocks.reserve(words.size() / block_words + 2);
+		std::uint64_t ones = 0;
+		for (std::size_t i = 0; i < words.size(); ++i) {
+			if (i % block_words == 0)
+				blocks.push_back(ones);
+			ones += std::popcount(words[i]);
+		}
+		// the total closes the directory, so rank works up to size()
+		blocks.push_back(ones);
+		sample<true>(ones_samples);
+		sample<false>(zeros_samples);
+		words.shrink_to_fit();
+	}
+
+	// stays valid as long as the vector isn't changed
+	_Bit_view view() const noexcept {
+		return _Bit_view(words, blocks, ones_samples, zeros_samples, bits);
+	}
+
+private:
+	template<bool bit>
+	std::size_t count(std::size_t block) const noexcept {
+		return bit ? blocks[block] : block * block_bits - blocks[block];
+	}
+
+	// block holding the bit of every block_bits-th rank, closed by the number of blocks
+	template<bool bit>
+	void sample(std::vector<std::uint64_t, Alloc<std::uint64_t>>& samples) {
+		samples.clear();
+		std::size_t block_count = (words.size() + block_words - 1) / block_words;
+		for (std::size_t block = 0; block < block_count; ++block) {
+			std::size_t last = block + 1 < block_count ? count<bit>(block + 1) : (bit ? blocks.back() : bits - blocks.back());
+			while (samples.size() * block_bits < last)
+				samples.push_back(block);
+		}
+		samples.push_back(block_count);
+	}
+
+	std::vector<std::uint64_t, Alloc<std::uint64_t>> words;
+	std::vector<std::uint64_t, Alloc<std::uint64_t>> blocks;
+	std::vector<std::uint64_t, Alloc<std::uint64_t>> ones_samples;
+	std::vector<std::uint64_t, Alloc<std::uint64_t>> zeros_samples;
+	std::size_t bits;
+
+}; // class _Bit_vector
+
+} // namespace ltr
+
+#endif // LTR_BIT_VECTOR
@@ -0,0 +1,390 @@
+#pragma once
+
+#ifndef LTR_CHILD_INDEX
+#define LTR_CHILD_INDEX
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <algorithm>
+#include <vector>
+#include <bit>
+
+// sorted child keys of byte sized fragments are searched with vector compares where available,
+// defining LTR_NO_SIMD keeps the scalar search
+#if !defined(LTR_NO_SIMD)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LTR_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LTR_SIMD_SSE2
+#endif
+#endif
+
+namespace ltr {
+
+// byte sized fragments compared with std::less can be addressed directly,
+// their order matches the order of the slots they're mapped to
+template<typename K, typename Comp>
+inline constexpr bool _is_byte_ordered = sizeof(K) == 1 && std::is_integral_v<K> &&
+                                         (std::is_same_v<Comp, std::less<K>> || std::is_same_v<Comp, std::less<>>);
+
+// lookup accelerator attached to nodes whose fanout grew too big to scan the sibling list
+// the sibling list stays the owner of the ordering, the index only mirrors it:
+// - up to list_limit children there's no index, the list itself is scanned
+// - up to sorted_limit children keys and nodes are kept in sorted contiguous arrays
+// - above that byte sized fragments switch to a direct 256 slot table,
+//   any other fragment type keeps growing the sorted arrays
+// the direct table also keeps a fenwick tree over the weights of the children,
+// so the values in front of a child are summed without visiting its siblings
+// sorted byte sized keys are padded to whole vector blocks, the padding is never compared
+template<typename K,
+         typename N,	// associated node type
+         template<typename T> typename Alloc>
+class _Child_index {
+public:
+	static constexpr std::size_t list_limit   = 4;
+	static constexpr std::size_t sorted_limit = 48;
+	static constexpr std::size_t direct_floor = 32;
+
+	// builds the index from an already sorted sibling list
+	_Child_index(N* first, bool direct) : slots(nullptr), sums(nullptr), occupied{}, count(0) {
+		if (direct) {
+			if constexpr (sizeof(K) == 1 && std::is_integral_v<K>) {
+				allocate_slots();
+				for (N* n = first; n != nullptr; n = n->next)
+					set_slot(n);
+			}
+			return;
+		}
+		keys.reserve(16);
+		nodes.reserve(16);
+		for (N* n = first; n != nullptr; n = n->next) {
+			grow();
+			keys.push_back(n->key);
+			nodes.push_back(n);
+			++count;
+		}
+		keys.resize(padded(count));
+	}
+
+	_Child_index(const _Child_index& other) = delete;
+	_Child_index& operator=(const _Child_index& other) = delete;
+
+	~_Child_index() {
+		release_slots();
+	}
+
+	std::size_t size() const noexcept {
+		return count;
+	}
+
+	bool is_direct() const noexcept {
+		return slots != nullptr;
+	}
+
+	// returns the first child with a key not less than fragment, nullptr if there's none
+	template<typename Comp>
+	N* lower(const K& fragment, const Comp& comp) const {
+		if constexpr (_is_byte_ordered<K, Comp>) {
+			if (slots) {
+				std::size_t slot = slot_of(fragment);
+				if (slots[slot])
+					return slots[slot];
+				return next_occupied(slot + 1);
+			}
+		}
+		std::size_t pos = position(fragment, comp);
+		return pos == count ? nullptr : nodes[pos];
+	}
+
+	N* last() const noexcept {
+		if (slots) {
+			for (std::size_t word = 4; word-- > 0;) {
+				if (occupied[word])
+					return slots[word * 64 + 63 - std::countl_zero(occupied[word])];
+			}
+			return nullptr;
+		}
+		return nodes.empty() ? nullptr : nodes.back();
+	}
+
+	// sum of the weights of the children in front of n, total being the sum over every child
+	template<typename Comp>
+	std::size_t weight_before(const N* n, std::size_t total, const Comp& comp) const {
+		if constexpr (_is_byte_ordered<K, Comp>) {
+			if (slots) {
+				std::size_t sum = 0;
+				for (std::size_t i = slot_of(n->key); i > 0; i &= i - 1)
+					sum += sums[i - 1];
+				return sum;
+			}
+		}
+		// sums the shorter side of n
+		std::size_t pos = position(n->key, comp);
+		std::size_t sum = 0;
+		if (pos <= count / 2) {
+			for (std::size_t i = 0; i < pos; ++i)
+				sum += nodes[i]->weight;
+			return sum;
+		}
+		for (std::size_t i = pos; i < count; ++i)
+			sum += nodes[i]->weight;
+		return total - sum;
+	}
+
+	// returns the child whose subtree holds the n-th value below this index' node,
+	// n is reduced by the weights of the children in front of it
+	// n has to be less than the sum of the weights
+	N* find_weight(std::size_t& n) const noexcept {
+		if (slots) {
+			// descends the fenwick tree, the whole table never qualifies as n is less than its sum
+			std::size_t slot = 0;
+			for (std::size_t step = 128; step > 0; step /= 2) {
+				if (sums[slot + step - 1] <= n) {
+					n -= sums[slot + step - 1];
+					slot += step;
+				}
+			}
+			return slots[slot];
+		}
+		std::size_t i = 0;
+		while (n >= nodes[i]->weight)
+			n -= nodes[i++]->weight;
+		return nodes[i];
+	}
+
+	// keeps the fenwick tree in sync with a changed weight of n
+	void add_weight(const N* n, std::size_t delta) noexcept {
+		if (slots)
+			add_sum(slot_of(n->key), delta);
+	}
+
+	// registers a freshly linked child, n must not be present yet
+	template<typename Comp>
+	void insert(N* n, const Comp& comp) {
+		if constexpr (_is_byte_ordered<K, Comp>) {
+			if (slots) {
+				set_slot(n);
+				return;
+			}
+		}
+		std::size_t pos = position(n->key, comp);
+		grow();
+		if constexpr (byte_sized) {
+			keys.resize(padded(count + 1));
+			std::copy_backward(keys.begin() + pos, keys.begin() + count, keys.begin() + count + 1);
+			keys[pos] = n->key;
+		}
+		else
+			keys.insert(keys.begin() + pos, n->key);
+		nodes.insert(nodes.begin() + pos, n);
+		++count;
+
+		if constexpr (_is_byte_ordered<K, Comp>) {
+			if (count > sorted_limit)
+				to_direct();
+		}
+	}
+
+	template<typename Comp>
+	void erase(N* n, const Comp& comp) {
+		if constexpr (_is_byte_ordered<K, Comp>) {
+			if (slots) {
+				std::size_t slot = slot_of(n->key);
+				slots[slot] = nullptr;
+				occupied[slot / 64] &= ~(std::uint64_t(1) << (slot % 64));
+				add_sum(slot, 0 - n->weight);
+				--count;
+				if (count < direct_floor)
+					to_sorted();
+				return;
+			}
+		}
+		std::size_t pos = position(n->key, comp);
+		if constexpr (byte_sized) {
+			std::copy(keys.begin() + pos + 1, keys.begin() + count, keys.begin() + pos);
+			keys.resize(padded(count - 1));
+		}
+		else
+			keys.erase(keys.begin() + pos);
+		nodes.erase(nodes.begin() + pos);
+		--count;
+	}
+
+	// swaps the node registered for a key to another one with the same key
+	template<typename Comp>
+	void replace(N* old, N* n, const Comp& comp) {
+		if constexpr (_is_byte_ordered<K, Comp>) {
+			if (slots) {
+				slots[slot_of(old->key)] = n;
+				add_sum(slot_of(n->key), n->weight - old->weight);
+				return;
+			}
+		}
+		nodes[position(old->key, comp)] = n;
+	}
+
+private:
+	using slot_allocator = Alloc<N*>;
+	using slot_traits    = std::allocator_traits<slot_allocator>;
+	using sum_allocator  = Alloc<std::size_t>;
+	using sum_traits     = std::allocator_traits<sum_allocator>;
+
+	static constexpr bool byte_sized = sizeof(K) == 1 && std::is_integral_v<K>;
+
+#if defined(LTR_SIMD_AVX2)
+	static constexpr std::size_t block = 32;
+#elif defined(LTR_SIMD_SSE2)
+	static constexpr std::size_t block = 16;
+#else
+	static constexpr std::size_t block = 1;
+#endif
+
+	// length of the keys array holding n keys
+	static constexpr std::size_t padded(std::size_t n) noexcept {
+		if constexpr (byte_sized)
+			return (n + block - 1) / block * block;
+		else
+			return n;
+	}
+
+	// index of the first key not less than fragment in the sorted arrays
+	template<typename Comp>
+	std::size_t position(const K& fragment, const Comp& comp) const {
+#if defined(LTR_SIMD_AVX2) || defined(LTR_SIMD_SSE2)
+		if constexpr (_is_byte_ordered<K, Comp>) {
+			// the keys less than fragment are a prefix of the array, counted block by block
+			// the comparisons are signed, unsigned keys get their sign bit flipped
+			const char bias = std::is_signed_v<K> ? 0 : static_cast<char>(0x80);
+			const char needle = static_cast<char>(static_cast<char>(fragment) ^ bias);
+			std::size_t pos = 0;
+			for (std::size_t i = 0; i < count; i += block) {
+#if defined(LTR_SIMD_AVX2)
+				__m256i keys_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys.data() + i));
+				keys_block = _mm256_xor_si256(keys_block, _mm256_set1_epi8(bias));
+				std::uint32_t less = static_cast<std::uint32_t>(
+					_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(needle), keys_block)));
+#else
+				__m128i keys_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys.data() + i));
+				keys_block = _mm_xor_si128(keys_block, _mm_set1_epi8(bias));
+				std::uint32_t less = static_cast<std::uint32_t>(
+					_mm_movemask_epi8(_mm_cmplt_epi8(keys_block, _mm_set1_epi8(needle))));
+#endif
+				std::size_t matched = std::countr_one(less);
+				if (matched < block || count - i <= block)
+					return std::min(pos + matched, count);
+				pos += block;
+			}
+			return pos;
+		}
+#endif
+		return std::lower_bound(keys.begin(), keys.begin() + count, fragment, comp) - keys.begin();
+	}
+
+	static constexpr std::size_t slot_of(const K& key) noexcept {
+		// flipping the sign bit keeps signed fragments ordered
+		if constexpr (std::is_signed_v<K>)
+			return static_cast<unsigned char>(key) ^ 0x80u;
+		else
+			return static_cast<unsigned char>(key);
+	}
+
+	// sorted arrays grow through the 16 and 48 wide stages before doubling
+	void grow() {
+		if (count < keys.capacity())
+			return;
+		std::size_t capacity = keys.capacity() < 16 ? 16 : keys.capacity() < 48 ? 48 : keys.capacity() * 2;
+		keys.reserve(capacity);
+		nodes.reserve(capacity);
+	}
+
+	void allocate_slots() {
+		slot_allocator alloc;
+		sum_allocator sum_alloc;
+		slots = slot_traits::allocate(alloc, 256);
+		try {
+			sums = sum_traits::allocate(sum_alloc, 256);
+		}
+		catch (...) {
+			slot_traits::deallocate(alloc, slots, 256);
+			slots = nullptr;
+			throw;
+		}
+		std::fill_n(slots, 256, nullptr);
+		std::fill_n(sums, 256, 0);
+	}
+
+	void release_slots() {
+		if (slots) {
+			slot_allocator alloc;
+			sum_allocator sum_alloc;
+			slot_traits::deallocate(alloc, slots, 256);
+			sum_traits::deallocate(sum_alloc, sums, 256);
+			slots = nullptr;
+			sums = nullptr;
+		}
+	}
+
+	void set_slot(N* n) {
+		std::size_t slot = slot_of(n->key);
+		slots[slot] = n;
+		occupied[slot / 64] |= std::uint64_t(1) << (slot % 64);
+		add_sum(slot, n->weight);
+		++count;
+	}
+
+	// fenwick tree update, sums[i - 1] covers the slots [i - lowest bit of i, i)
+	// delta wraps around for decrements
+	void add_sum(std::size_t slot, std::size_t delta) noexcept {
+		for (std::size_t i = slot + 1; i <= 256; i += i & (0 - i))
+			sums[i - 1] += delta;
+	}
+
+	N* next_occupied(std::size_t slot) const noexcept {
+		while (slot < 256) {
+			std::uint64_t word = occupied[slot / 64] >> (slot % 64);
+			if (word)
+				return slots[slot + std::countr_zero(word)];
+			slot = (slot / 64 + 1) * 64;
+		}
+		return nullptr;
+	}
+
+	void to_direct() {
+		allocate_slots();
+		count = 0;
+		for (N* n : nodes)
+			set_slot(n);
+		keys = {};
+		nodes = {};
+	}
+
+	void to_sorted() {
+		keys.reserve(sorted_limit);
+		nodes.reserve(sorted_limit);
+		for (std::size_t slot = 0; slot < 256; ++slot) {
+			if (slots[slot]) {
+				keys.push_back(slots[slot]->key);
+				nodes.push_back(slots[slot]);
+			}
+		}
+		keys.resize(padded(count));
+		release_slots();
+		std::fill_n(occupied, 4, 0);
+	}
+
+	std::vector<K, Alloc<K>> keys;
+	std::vector<N*, Alloc<N*>> nodes;
+	N** slots;	// direct table, nullptr while the sorted arrays are in use
+	std::size_t* sums;	// fenwick tree over the weights of the direct table's children
+	std::uint64_t occupied[4];
+	std::size_t count;
+
+}; // class _Child_index
+
+} // namespace ltr
+
+#endif // LTR_CHILD_INDEX
@@ -0,0 +1,179 @@
+#pragma once
+
+#ifndef LTR_CONCURRENT_TRIE
+#define LTR_CONCURRENT_TRIE
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "epoch.hpp"
+
+namespace ltr {
+
+// trie read by any number of threads without locks while a single writer changes it
+// the writer changes a private instance and publish swaps it with the one readers see,
+// the retired instance then catches up on the same changes once the readers still on it have left,
+// so readers never see a node being changed or freed and a publish costs the changes, not a copy
+// the price is two full instances, twice the memory of one trie, and a writer that waits on readers:
+// publish itself returns right away, but the first change after it waits until every reader pinned
+// before the publish has left, so a long iteration over the previous version stalls the writer that long
+template<typename Trie>		// associated trie type
+class concurrent_trie {
+private:
+	enum _Change_kind : unsigned char {
+		insert_change,
+		assign_change,
+		erase_change,
+		clear_change,
+	};
+
+	struct _Change {
+		_Change_kind kind;
+		typename Trie::key_type key;
+		std::optional<typename Trie::mapped_type> value;
+	};
+
+public:
+	using key_type    = typename Trie::key_type;
+	using mapped_type = typename Trie::mapped_type;
+	using value_type  = typename Trie::value_type;
+	using size_type   = typename Trie::size_type;
+	using key_concat  = typename Trie::key_concat;
+	using key_compare = typename Trie::key_compare;
+
+	// pins the published trie for reading, the trie and its iterators stay valid until the guard is destroyed
+	class read_guard {
+	public:
+		read_guard(const read_guard& other) = delete;
+		read_guard(read_guard&& other) noexcept : domain(std::exchange(other.domain, nullptr)), slot(other.slot), trie(other.trie) {}
+		read_guard& operator=(const read_guard& other) = delete;
+		read_guard& operator=(read_guard&& other) = delete;
+
+		~read_guard() {
+			if (domain)
+				domain->unpin(slot);
+		}
+
+		const Trie& operator*() const noexcept {
+			return *trie;
+		}
+
+		const Trie* operator->() const noexcept {
+			return trie;
+		}
+
+	private:
+		friend class concurrent_trie;
+
+		read_guard(_Epoch_domain& domain, const std::atomic<const Trie*>& published) noexcept : domain(&domain), slot(domain.pin()), trie(published.load()) {}
+
+		_Epoch_domain* domain;
+		std::size_t slot;
+		const Trie* trie;
+	};
+
+	concurrent_trie(const key_concat& concat, const key_compare& comp = key_compare())
+		: instances{ Trie(concat, comp), Trie(concat, comp) }, published(&instances[0]), writing(1), retired(0) {}
+
+	concurrent_trie(const concurrent_trie& other) = delete;
+	concurrent_trie& operator=(const concurrent_trie& other) = delete;
+
+	// ------------------ readers ------------------
+	// safe from any thread at any time
+
+	read_guard read() const noexcept {
+		return read_guard(domain, published);
+	}
+
+	// ------------------ writer -------------------
+	// only one thread at a time, changes are seen by readers once published
+
+	bool insert(const value_type& value) {
+		bool inserted = writer().insert(value).second;
+		if (inserted)
+			changes.push_back(_Change{ insert_change, value.first, value.second });
+		return inserted;
+	}
+
+	template<typename M>
+	bool insert_or_assign(const key_type& key, M&& obj) {
+		auto result = writer().insert_or_assign(key, std::forward<M>(obj));
+		changes.push_back(_Change{ assign_change, key, result.first->second });
+		return result.second;
+	}
+
+	size_type erase(const key_type& key) {
+		size_type erased = writer().erase(key);
+		if (erased)
+			changes.push_back(_Change{ erase_change, key, std::nullopt });
+		return erased;
+	}
+
+	void clear() {
+		writer().clear();
+		changes.push_back(_Change{ clear_change, key_type(), std::nullopt });
+	}
+
+	// makes the changes so far visible to readers started from now on
+	// the next change waits for the readers still on the instance unpublished here
+	void publish() {
+		if (changes.empty())
+			return;
+		published.store(&instances[writing]);
+		retired = domain.advance();
+		writing ^= 1;
+		lagging.swap(changes);
+		changes.clear();
+	}
+
+	// the writer's instance, with the changes not published yet
+	const Trie& unpublished() {
+		return writer();
+	}
+
+private:
+	// the instance the writer changes, brought up to date once readers left it
+	Trie& writer() {
+		if (!lagging.empty()) {
+			domain.synchronize(retired);
+			for (const _Change& change : lagging)
+				apply(instances[writing], change);
+			lagging.clear();
+		}
+		return instances[writing];
+	}
+
+	static void apply(Trie& trie, const _Change& change) {
+		switch (change.kind) {
+		case insert_change:
+			trie.insert(value_type(change.key, *change.value));
+			break;
+		case assign_change:
+			trie.insert_or_assign(change.key, *change.value);
+			break;
+		case erase_change:
+			trie.erase(change.key);
+			break;
+		case clear_change:
+			trie.clear();
+			break;
+		}
+	}
+
+	Trie instances[2];
+	std::atomic<const Trie*> published;
+	mutable _Epoch_domain domain;
+	std::size_t writing;			// index of the writer's instance
+	std::uint64_t retired;			// epoch started when the writer's instance was last unpublished
+	std::vector<_Change> changes;	// applied to the writer's instance, not published yet
+	std::vector<_Change> lagging;	// published changes the writer's instance hasn't caught up on
+
+}; // class concurrent_trie
+
+} // namespace ltr
+
+#endif // LTR_CONCURRENT_TRIE
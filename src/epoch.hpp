@@ -0,0 +1,124 @@
+#pragma once
+
+#ifndef LTR_EPOCH
+#define LTR_EPOCH
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace ltr {
+
+// epoch based grace periods for memory read without locks
+// readers pin the current epoch in a slot while they read, writers advance the epoch after unlinking memory
+// and may reuse or free it once no slot holds an epoch older than the advanced one
+// memory can also be retired to the slot of the thread unlinking it, to be freed once that holds
+class _Epoch_domain {
+public:
+	static constexpr std::size_t slot_count = 128;
+	static constexpr std::size_t retire_batch = 64;
+	static constexpr std::uint64_t idle = 0;
+
+	_Epoch_domain() noexcept : global(1) {}
+	_Epoch_domain(const _Epoch_domain& other) = delete;
+	_Epoch_domain& operator=(const _Epoch_domain& other) = delete;
+
+	// no reader may be left by then, so whatever is still retired is freed
+	~_Epoch_domain() {
+		for (_Slot& slot : slots) {
+			for (const _Retired& retired : slot.retired)
+				retired.deleter(retired.memory);
+		}
+	}
+
+	// takes a free slot holding the current epoch, starting from one picked by the thread's id,
+	// only spins if every slot is taken, returns the slot for unpin
+	std::size_t pin() noexcept {
+		std::size_t slot = std::hash<std::thread::id>()(std::this_thread::get_id()) % slot_count;
+		while (true) {
+			std::uint64_t expected = idle;
+			if (slots[slot].epoch.load(std::memory_order_relaxed) == idle &&
+			    slots[slot].epoch.compare_exchange_strong(expected, global.load()))
+				return slot;
+			slot = (slot + 1) % slot_count;
+		}
+	}
+
+	void unpin(std::size_t slot) noexcept {
+		slots[slot].epoch.store(idle, std::memory_order_release);
+	}
+
+	// starts a new epoch, memory unlinked before is safe once synchronize returns for it
+	std::uint64_t advance() noexcept {
+		return global.fetch_add(1) + 1;
+	}
+
+	// whether every reader pinned before epoch started has left
+	bool quiescent(std::uint64_t epoch) const noexcept {
+		for (const _Slot& slot : slots) {
+			std::uint64_t pinned = slot.epoch.load();
+			if (pinned != idle && pinned < epoch)
+				return false;
+		}
+		return true;
+	}
+
+	// waits until the readers pinned before epoch started have left
+	void synchronize(std::uint64_t epoch) const noexcept {
+		while (!quiescent(epoch))
+			std::this_thread::yield();
+	}
+
+	// frees memory unlinked by the thread pinned in slot once the readers which could still see it have left
+	// the memory is stamped with the current epoch, the epoch is only advanced every retire_batch retirements of the slot,
+	// when the slot's memory is checked, so writers don't all contend on the global epoch
+	void retire(std::size_t slot, void* memory, void (*deleter)(void*)) {
+		std::vector<_Retired>& retired = slots[slot].retired;
+		retired.push_back(_Retired{ memory, deleter, global.load() });
+		if (retired.size() % retire_batch != 0)
+			return;
+		// readers pinned from now on can't see any of it
+		advance();
+		// the slot's own thread doesn't hold what it retired, anyone else pinned up to the retirement might
+		std::uint64_t oldest = global.load();
+		for (std::size_t i = 0; i < slot_count; ++i) {
+			std::uint64_t pinned = slots[i].epoch.load();
+			if (i != slot && pinned != idle)
+				oldest = std::min(oldest, pinned);
+		}
+		auto kept = retired.begin();
+		for (const _Retired& entry : retired) {
+			if (entry.epoch < oldest)
+				entry.deleter(entry.memory);
+			else
+				*kept++ = entry;
+		}
+		retired.erase(kept, retired.end());
+	}
+
+private:
+	struct _Retired {
+		void* memory;
+		void (*deleter)(void*);
+		std::uint64_t epoch;	// epoch current when it was unlinked
+	};
+
+	// a slot per cache line, so pinning readers don't contend on their neighbours' lines
+	// the retired memory is only touched by the thread pinned in the slot
+	struct alignas(64) _Slot {
+		std::atomic<std::uint64_t> epoch{ idle };
+		std::vector<_Retired> retired;
+	};
+
+	std::atomic<std::uint64_t> global;
+	_Slot slots[slot_count];
+
+}; // class _Epoch_domain
+
+} // namespace ltr
+
+#endif // LTR_EPOCH
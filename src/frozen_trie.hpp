@@ -0,0 +1,683 @@
+#pragma once
+
+#ifndef LTR_FROZEN_TRIE
+#define LTR_FROZEN_TRIE
+
+#include <utility>
+#include <string>
+#include <memory>
+#include <type_traits>
+#include <stdexcept>
+#include <iterator>
+#include <algorithm>
+#include <vector>
+#include <ranges>
+#include <span>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <ostream>
+
+#include "node.hpp"
+#include "bit_vector.hpp"
+#include "iterators.hpp"
+
+namespace ltr {
+
+template<typename K,
+		 typename V,
+		 typename Concat_expr_t,
+		 template<typename T>    typename Comp,
+		 template<typename SeqT, typename SeqTraits, typename SeqAlloc> typename Seq,
+		 template<typename T>    typename Traits,
+		 template<typename T>    typename Alloc,
+		 trie_layout Layout>
+class trie;
+
+// Bidirectional iterator class for frozen tries
+// keeps the path from the root as node numbers along with the range of siblings of each,
+// the path only holding the root is the end, dereferencing rebuilds the key like _Key_iterator
+template<typename F>	// associated frozen trie type
+class _Frozen_iterator {
+private:
+	using frame = typename F::_Frame;
+public:
+	using difference_type   = std::ptrdiff_t;
+	using value_type        = typename F::value_type;
+	using reference         = typename F::const_reference;
+	using pointer           = _Arrow_proxy<reference>;
+	using iterator_category = std::bidirectional_iterator_tag;
+
+	_Frozen_iterator() noexcept : owner(nullptr) {}
+	_Frozen_iterator(const F* owner, std::vector<frame>&& path) noexcept : owner(owner), path(std::move(path)) {}
+
+	reference operator*() const {
+		return owner->element(path);
+	}
+
+	pointer operator->() const {
+		return pointer{ **this };
+	}
+
+	friend bool operator==(const _Frozen_iterator& lhs, const _Frozen_iterator& rhs) {
+		return lhs.path.back().node == rhs.path.back().node;
+	}
+
+	friend bool operator!=(const _Frozen_iterator& lhs, const _Frozen_iterator& rhs) {
+		return !(lhs == rhs);
+	}
+
+	_Frozen_iterator& operator++() {
+		owner->advance(path);
+		return *this;
+	}
+
+	_Frozen_iterator operator++(int) {
+		_Frozen_iterator old = *this;
+		owner->advance(path);
+		return old;
+	}
+
+	_Frozen_iterator& operator--() {
+		owner->retreat(path);
+		return *this;
+	}
+
+	_Frozen_iterator operator--(int) {
+		_Frozen_iterator old = *this;
+		owner->retreat(path);
+		return old;
+	}
+
+private:
+	const F* owner;
+	std::vector<frame> path;
+}; // class _Frozen_iterator
+
+// read-only snapshot of a trie, built by trie::freeze or from a trie directly
+// the topology is a LOUDS bit vector, nodes are numbered in breadth-first order
+// and every node writes a one for each of its children followed by a zero,
+// so the children of a node are consecutive numbers found with select and rank
+// first fragments, the rest of compressed nodes' fragments and the mapped values sit in packed arrays,
+// keys are rebuilt with the concatenation expression like with implicit_keys
+// every part is read through views, so a snapshot either owns its storage or views an image written by write,
+// for instance a mapped file, without copying anything out of it
+template<typename K,
+		 typename V,
+		 typename Concat_expr_t,
+		 template<typename T>    typename Comp   = std::less,
+		 template<typename SeqT, typename SeqTraits, typename SeqAlloc> typename Seq = std::basic_string,
+		 template<typename T>    typename Traits = std::char_traits,
+		 template<typename T>    typename Alloc  = std::allocator>
+class frozen_trie {
+	template<typename F>
+	friend class _Frozen_iterator;
+
+	template<typename K_, typename V_, typename C_,
+	         template<typename T> typename Comp_,
+	         template<typename SeqT, typename SeqTraits, typename SeqAlloc> typename Seq_,
+	         template<typename T> typename Traits_,
+	         template<typename T> typename Alloc_,
+	         trie_layout Layout_>
+	friend class trie;
+
+	// a node of an iterator's path, first and last bound its siblings
+	struct _Frame {
+		std::size_t node, first, last;
+	};
+
+	using bits_type = _Bit_vector<Alloc>;
+
+	// the parts of snapshots taken from a trie, shared by the copies of a snapshot
+	struct _Storage {
+		bits_type louds;
+		bits_type tails;
+		bits_type has_value;
+		std::vector<K, Alloc<K>> keys;
+		std::vector<K, Alloc<K>> tail_fragments;
+		std::vector<V, Alloc<V>> values;
+	};
+
+	// an image starts with the header, followed by the sections of the three bit vectors,
+	// the first fragments, the other fragments and the mapped values, each padded to image_alignment
+	static constexpr char image_magic[8] = { 'l', 't', 'r', 'i', 'm', 'a', 'g', '1' };
+	static constexpr std::uint32_t image_byte_order = 0x01020304;
+	static constexpr std::size_t image_alignment = std::max({ alignof(std::uint64_t), alignof(K), alignof(V) });
+	static constexpr std::size_t image_sections = 3 * 4 + 3;
+
+	struct _Image_header {
+		char magic[8];
+		std::uint32_t byte_order;
+		std::uint32_t fragment_size;
+		std::uint32_t value_size;
+		std::uint32_t alignment;
+		std::uint64_t bits[3];					// sizes of the bit vectors
+		std::uint64_t sizes[image_sections];	// number of elements in every section
+	};
+
+public:
+
+	// ---------------- member types ---------------
+
+	using key_type               = Seq<K, Traits<K>, Alloc<K>>;
+	using mapped_type            = V;
+	using value_type             = std::pair<const key_type, V>;
+	using key_concat             = Concat_expr_t;
+	using size_type              = std::size_t;
+	using difference_type        = std::ptrdiff_t;
+	using key_compare            = Comp<K>;
+	using const_reference        = _Key_value_ref<key_type, const V&>;
+	using reference              = const_reference;
+	using const_iterator         = _Frozen_iterator<frozen_trie>;
+	using iterator               = const_iterator;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using reverse_iterator       = const_reverse_iterator;
+
+	// ------------------- ctors -------------------
+
+	// an empty snapshot
+	frozen_trie(const key_concat& concat, const key_compare& comp = key_compare()) : _concat(concat), _comp(comp) {
+		build<_Node<K, V, Alloc>>(nullptr, [](const auto* node) -> const V& { return *node->value; });
+	}
+
+	template<trie_layout Layout>
+	explicit frozen_trie(const trie<K, V, Concat_expr_t, Comp, Seq, Traits, Alloc, Layout>& source) : frozen_trie(source.freeze()) {}
+
+	// views an image written by write, nothing is copied or allocated and the image has to outlive the snapshot
+	// the bit vectors' rank directories and select samples are checked against their words, which takes a pass over them,
+	// and their counts of ones against the number of nodes
+	// throws std::invalid_argument if the image is malformed or was written for other fragment or mapped types
+	frozen_trie(std::span<const std::byte> image, const key_concat& concat, const key_compare& comp = key_compare()) : _concat(concat), _comp(comp) {
+		_Image_header header;
+		if (image.size() < sizeof(header) || reinterpret_cast<std::uintptr_t>(image.data()) % image_alignment != 0)
+			throw std::invalid_argument("invalid trie image");
+		std::memcpy(&header, image.data(), sizeof(header));
+		if (std::memcmp(header.magic, image_magic, sizeof(image_magic)) != 0 || header.byte_order != image_byte_order ||
+		    header.fragment_size != sizeof(K) || header.value_size != sizeof(V) || header.alignment != image_alignment)
+			throw std::invalid_argument("invalid trie image");
+
+		std::size_t offset = padded(sizeof(header));
+		std::size_t section = 0;
+		auto next = [&]<typename T>(std::span<const T>& part) {
+			std::uint64_t count = header.sizes[section++];
+			if (count > (image.size() - offset) / sizeof(T))
+				throw std::invalid_argument("invalid trie image");
+			part = std::span<const T>(reinterpret_cast<const T*>(image.data() + offset), count);
+			offset = std::min<std::size_t>(padded(offset + count * sizeof(T)), image.size());
+		};
+		_Bit_view* bits[3] = { &_louds, &_tails, &_has_value };
+		for (std::size_t i = 0; i < 3; ++i) {
+			std::span<const std::uint64_t> parts[4];
+			for (std::span<const std::uint64_t>& part : parts)
+				next(part);
+			*bits[i] = _Bit_view(parts[0], parts[1], parts[2], parts[3], header.bits[i]);
+			if (!bits[i]->valid())
+				throw std::invalid_argument("invalid trie image");
+		}
+		next(_keys);
+		next(_tail_fragments);
+		next(_values);
+		// a one per node but the root in _louds and a one per node, the root's first, in _tails keep the node numbers
+		// that children and fragments return within the sections
+		if (_keys.empty() || _louds.size() != 2 * _keys.size() - 1 || _louds.rank1(_louds.size()) != _keys.size() - 1 ||
+		    _tails.size() != _keys.size() + _tail_fragments.size() || _tails.rank1(_tails.size()) != _keys.size() || !_tails[0] ||
+		    _has_value.size() != _keys.size() || _has_value.rank1(_has_value.size()) != _values.size())
+			throw std::invalid_argument("invalid trie image");
+	}
+
+	// -------------- element access ---------------
+
+	const mapped_type& at(const key_type& key) const {
+		std::pair<std::size_t, bool> result = find_node(key);
+		if (!result.second)
+			throw std::out_of_range("invalid trie key");
+		return value_of(result.first);
+	}
+
+	// ----------------- iterators -----------------
+
+	const_iterator begin() const {
+		const_iterator it = end();
+		++it;
+		return it;
+	}
+
+	const_iterator cbegin() const {
+		return begin();
+	}
+
+	const_iterator end() const {
+		return const_iterator(this, root_path());
+	}
+
+	const_iterator cend() const {
+		return end();
+	}
+
+	const_reverse_iterator rbegin() const {
+		return const_reverse_iterator(end());
+	}
+
+	const_reverse_iterator crbegin() const {
+		return rbegin();
+	}
+
+	const_reverse_iterator rend() const {
+		return const_reverse_iterator(begin());
+	}
+
+	const_reverse_iterator crend() const {
+		return rend();
+	}
+
+	// ----------------- capacity ------------------
+
+	bool empty() const noexcept {
+		return _values.empty();
+	}
+
+	size_type size() const noexcept {
+		return _values.size();
+	}
+
+	// bytes taken by the topology, the fragments and the mapped values, not counting the image's header
+	size_type memory_size() const noexcept {
+		return _louds.memory_size() + _tails.memory_size() + _has_value.memory_size() +
+		       _keys.size() * sizeof(K) + _tail_fragments.size() * sizeof(K) + _values.size() * sizeof(V);
+	}
+
+	// ------------------ lookup -------------------
+	// keys are key_type or any contiguous range of fragments
+
+	template<typename key_t, std::enable_if_t<_Fragment_range<key_t, K>, bool> = true>
+	size_type count(const key_t& key) const {
+		return find_node(key).second ? 1 : 0;
+	}
+
+	size_type count(const key_type& key) const {
+		return find_node(key).second ? 1 : 0;
+	}
+
+	template<typename key_t, std::enable_if_t<_Fragment_range<key_t, K>, bool> = true>
+	bool contains(const key_t& key) const {
+		return find_node(key).second;
+	}
+
+	bool contains(const key_type& key) const {
+		return find_node(key).second;
+	}
+
+	template<typename key_t, std::enable_if_t<_Fragment_range<key_t, K>, bool> = true>
+	const_iterator find(const key_t& key) const {
+		std::vector<_Frame> path = root_path();
+		std::size_t node = 0;
+		if (!descend(node, &path, std::ranges::begin(key), std::ranges::end(key)))
+			path.resize(1);
+		return const_iterator(this, std::move(path));
+	}
+
+	const_iterator find(const key_type& key) const {
+		return find<key_type>(key);
+	}
+
+	template<typename key_t, std::enable_if_t<_Fragment_range<key_t, K>, bool> = true>
+	const_iterator lower_bound(const key_t& key) const {
+		return const_iterator(this, bound(std::ranges::begin(key), std::ranges::end(key), false));
+	}
+
+	const_iterator lower_bound(const key_type& key) const {
+		return lower_bound<key_type>(key);
+	}
+
+	template<typename key_t, std::enable_if_t<_Fragment_range<key_t, K>, bool> = true>
+	const_iterator upper_bound(const key_t& key) const {
+		return const_iterator(this, bound(std::ranges::begin(key), std::ranges::end(key), true));
+	}
+
+	const_iterator upper_bound(const key_type& key) const {
+		return upper_bound<key_type>(key);
+	}
+
+	template<typename key_t, std::enable_if_t<_Fragment_range<key_t, K>, bool> = true>
+	std::pair<const_iterator, const_iterator> equal_range(const key_t& key) const {
+		return std::make_pair(lower_bound(key), upper_bound(key));
+	}
+
+	std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const {
+		return std::make_pair(lower_bound(key), upper_bound(key));
+	}
+
+	// ------------------- image -------------------
+
+	// writes the snapshot in the layout it's read in, to be viewed later by the image constructor
+	// the bytes of fragments and mapped values are copied as they are, an image is only read back on machines of the same byte order
+	void write(std::ostream& out) const {
+		static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+		              "images store fragments and mapped values as raw bytes");
+		_Image_header header{};
+		std::memcpy(header.magic, image_magic, sizeof(image_magic));
+		header.byte_order = image_byte_order;
+		header.fragment_size = sizeof(K);
+		header.value_size = sizeof(V);
+		header.alignment = image_alignment;
+
+		std::vector<std::pair<const void*, std::size_t>> parts;
+		const _Bit_view* bits[3] = { &_louds, &_tails, &_has_value };
+		for (std::size_t i = 0; i < 3; ++i) {
+			header.bits[i] = bits[i]->size();
+			for (std::span<const std::uint64_t> part : bits[i]->sections())
+				parts.emplace_back(part.data(), part.size_bytes());
+		}
+		parts.emplace_back(_keys.data(), _keys.size_bytes());
+		parts.emplace_back(_tail_fragments.data(), _tail_fragments.size_bytes());
+		parts.emplace_back(_values.data(), _values.size_bytes());
+		header.sizes[image_sections - 3] = _keys.size();
+		header.sizes[image_sections - 2] = _tail_fragments.size();
+		header.sizes[image_sections - 1] = _values.size();
+		for (std::size_t i = 0; i < image_sections - 3; ++i)
+			header.sizes[i] = parts[i].second / sizeof(std::uint64_t);
+
+		const char padding[image_alignment] = {};
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(padding, padded(sizeof(header)) - sizeof(header));
+		for (const std::pair<const void*, std::size_t>& part : parts) {
+			out.write(static_cast<const char*>(part.first), part.second);
+			out.write(padding, padded(part.second) - part.second);
+		}
+	}
+
+	// ----------------- observers -----------------
+
+	key_compare key_comp() const {
+		return _comp;
+	}
+
+	// ----------------- nonmember -----------------
+
+	friend bool operator==(const frozen_trie& lhs, const frozen_trie& rhs) {
+		return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+	}
+
+	friend bool operator!=(const frozen_trie& lhs, const frozen_trie& rhs) {
+		return !(lhs == rhs);
+	}
+
+private:
+	// snapshots a tree of trie nodes, mapped gives the mapped value of a node with a value
+	template<typename N, typename Mapped>
+	frozen_trie(const N* root, Mapped&& mapped, const key_concat& concat, const key_compare& comp) : _concat(concat), _comp(comp) {
+		build<N>(root, mapped);
+	}
+
+	// numbers the nodes breadth-first, writing their degrees, fragments and values in that order
+	template<typename N, typename Mapped>
+	void build(const N* root, Mapped&& mapped) {
+		std::shared_ptr<_Storage> storage = std::allocate_shared<_Storage>(Alloc<_Storage>());
+		std::vector<const N*> queue;
+		if (root)
+			queue.push_back(root);
+		else
+			storage->louds.push_back(false);
+		storage->keys.push_back(K());
+		storage->tails.push_back(true);
+		storage->has_value.push_back(false);
+		for (std::size_t head = 0; head < queue.size(); ++head) {
+			const N* node = queue[head];
+			for (const N* child = node->child; child != nullptr; child = child->next) {
+				storage->louds.push_back(true);
+				queue.push_back(child);
+				storage->keys.push_back(child->key);
+				storage->tails.push_back(true);
+				for (std::size_t i = 1; i < child->length(); ++i) {
+					storage->tails.push_back(false);
+					storage->tail_fragments.push_back(child->fragment(i));
+				}
+				storage->has_value.push_back(child->value.has_value());
+				if (child->value.has_value())
+					storage->values.push_back(mapped(child));
+			}
+			storage->louds.push_back(false);
+		}
+		storage->louds.build();
+		storage->tails.build();
+		storage->has_value.build();
+		storage->keys.shrink_to_fit();
+		storage->tail_fragments.shrink_to_fit();
+		storage->values.shrink_to_fit();
+
+		_louds = storage->louds.view();
+		_tails = storage->tails.view();
+		_has_value = storage->has_value.view();
+		_keys = storage->keys;
+		_tail_fragments = storage->tail_fragments;
+		_values = storage->values;
+		_storage = std::move(storage);
+	}
+
+	static constexpr std::size_t padded(std::size_t size) noexcept {
+		return (size + image_alignment - 1) / image_alignment * image_alignment;
+	}
+
+	// ------------------ topology -----------------
+	// values of children come in breadth-first order too, which is why they're added when the parent is visited
+
+	std::vector<_Frame> root_path() const {
+		return std::vector<_Frame>(1, _Frame{ 0, 0, 1 });
+	}
+
+	// children of node are the numbers in [first, last)
+	std::pair<std::size_t, std::size_t> children(std::size_t node) const noexcept {
+		// node's degree bits start after the zero closing the previous node,
+		// the ones in front of them are the children of the nodes before it
+		std::size_t start = node == 0 ? 0 : _louds.select0(node - 1) + 1;
+		std::size_t stop = _louds.template next<false>(start);
+		std::size_t first = start - node + 1;
+		return std::make_pair(first, first + (stop - start));
+	}
+
+	bool has_children(std::size_t node) const noexcept {
+		std::size_t start = node == 0 ? 0 : _louds.select0(node - 1) + 1;
+		return _louds[start];
+	}
+
+	bool has_value(std::size_t node) const noexcept {
+		return _has_value[node];
+	}
+
+	const V& value_of(std::size_t node) const noexcept {
+		return _values[_has_value.rank1(node)];
+	}
+
+	// number of fragments of node and the position of its second one in _tail_fragments
+	std::pair<std::size_t, std::size_t> fragments(std::size_t node) const noexcept {
+		if (_tail_fragments.empty())
+			return std::make_pair(1, 0);
+		std::size_t start = _tails.select1(node);
+		std::size_t stop = _tails.template next<true>(start + 1);
+		return std::make_pair(stop - start, start - node);
+	}
+
+	const K& fragment(std::size_t node, std::size_t offset, std::size_t i) const noexcept {
+		return i == 0 ? _keys[node] : _tail_fragments[offset + i - 1];
+	}
+
+	bool equivalent(const K& lhs, const K& rhs) const {
+		return !_comp(lhs, rhs) && !_comp(rhs, lhs);
+	}
+
+	// ----------------- traversal -----------------
+
+	// moves to the first node with a value in the subtree of the path's last node
+	void first_value(std::vector<_Frame>& path) const {
+		while (path.size() == 1 || !has_value(path.back().node)) {
+			std::pair<std::size_t, std::size_t> range = children(path.back().node);
+			if (range.first == range.second)
+				return;
+			path.push_back(_Frame{ range.first, range.first, range.second });
+		}
+	}
+
+	// moves to the last node of the subtree of the path's last node
+	void last_node(std::vector<_Frame>& path) const {
+		while (true) {
+			std::pair<std::size_t, std::size_t> range = children(path.back().node);
+			if (range.first == range.second)
+				return;
+			path.push_back(_Frame{ range.second - 1, range.first, range.second });
+		}
+	}
+
+	// moves to the first node with a value after the subtree of the path's last node, the root if there's none
+	void skip_subtree(std::vector<_Frame>& path) const {
+		while (path.size() > 1) {
+			_Frame& top = path.back();
+			if (top.node + 1 < top.last) {
+				++top.node;
+				first_value(path);
+				return;
+			}
+			path.pop_back();
+		}
+	}
+
+	// next node with a value in iteration order, from the root to the first one
+	void advance(std::vector<_Frame>& path) const {
+		if (has_children(path.back().node)) {
+			std::pair<std::size_t, std::size_t> range = children(path.back().node);
+			path.push_back(_Frame{ range.first, range.first, range.second });
+			first_value(path);
+		}
+		else
+			skip_subtree(path);
+	}
+
+	// previous node with a value in iteration order, from the root to the last one
+	void retreat(std::vector<_Frame>& path) const {
+		if (path.size() == 1) {
+			last_node(path);
+			return;
+		}
+		while (path.size() > 1) {
+			_Frame& top = path.back();
+			if (top.node > top.first) {
+				--top.node;
+				last_node(path);
+				return;
+			}
+			path.pop_back();
+			if (path.size() > 1 && has_value(path.back().node))
+				return;
+		}
+	}
+
+	// ------------------ lookup -------------------
+
+	// follows the key's fragments from the root, returns whether they end at a node with a value,
+	// the nodes on the way are appended to path unless it's null
+	template<typename It, typename End>
+	bool descend(std::size_t& node, std::vector<_Frame>* path, It it, End last) const {
+		if (it == last)
+			throw std::invalid_argument("key must be of positive size");
+		while (it != last) {
+			std::pair<std::size_t, std::size_t> range = children(node);
+			std::size_t next = lower_child(range, *it);
+			if (next == range.second || _comp(*it, _keys[next]))
+				return false;
+			node = next;
+			if (path)
+				path->push_back(_Frame{ next, range.first, range.second });
+
+			++it;
+			std::pair<std::size_t, std::size_t> length = fragments(next);
+			for (std::size_t i = 1; i < length.first; ++i, ++it) {
+				if (it == last || !equivalent(*it, fragment(next, length.second, i)))
+					return false;
+			}
+		}
+		return has_value(node);
+	}
+
+	template<typename key_t>
+	std::pair<std::size_t, bool> find_node(const key_t& key) const {
+		std::size_t node = 0;
+		bool found = descend(node, nullptr, std::ranges::begin(key), std::ranges::end(key));
+		return std::make_pair(node, found);
+	}
+
+	// first child in range with a key not less than fragment, range.second if there's none
+	std::size_t lower_child(const std::pair<std::size_t, std::size_t>& range, const K& fragment) const {
+		return std::lower_bound(_keys.begin() + range.first, _keys.begin() + range.second, fragment, _comp) - _keys.begin();
+	}
+
+	// path to the first node with a value not less than key, or greater if upper is set, like trie::find_bound
+	template<typename It, typename End>
+	std::vector<_Frame> bound(It it, End last, bool upper) const {
+		if (it == last)
+			throw std::invalid_argument("key must be of positive size");
+		std::vector<_Frame> path = root_path();
+		while (it != last) {
+			std::pair<std::size_t, std::size_t> range = children(path.back().node);
+			std::size_t next = lower_child(range, *it);
+			// every child is less than key
+			if (next == range.second) {
+				skip_subtree(path);
+				return path;
+			}
+			path.push_back(_Frame{ next, range.first, range.second });
+			// next and the siblings after it are all greater
+			if (_comp(*it, _keys[next])) {
+				first_value(path);
+				return path;
+			}
+
+			++it;
+			std::pair<std::size_t, std::size_t> length = fragments(next);
+			for (std::size_t i = 1; i < length.first; ++i, ++it) {
+				// key is a prefix of the node's path, or branches off to the left
+				if (it == last || _comp(*it, fragment(next, length.second, i))) {
+					first_value(path);
+					return path;
+				}
+				// key branches off to the right
+				if (_comp(fragment(next, length.second, i), *it)) {
+					skip_subtree(path);
+					return path;
+				}
+			}
+		}
+		// key is on the path of the last node
+		if (has_value(path.back().node)) {
+			if (upper)
+				advance(path);
+		}
+		else
+			first_value(path);
+		return path;
+	}
+
+	// concatenates the fragments on the path to the element
+	const_reference element(const std::vector<_Frame>& path) const {
+		key_type key;
+		for (std::size_t i = 1; i < path.size(); ++i) {
+			std::pair<std::size_t, std::size_t> length = fragments(path[i].node);
+			for (std::size_t j = 0; j < length.first; ++j)
+				_concat(key, fragment(path[i].node, length.second, j));
+		}
+		return const_reference{ std::move(key), value_of(path.back().node) };
+	}
+
+	key_concat _concat;
+	key_compare _comp;
+	std::shared_ptr<const _Storage> _storage;	// null when viewing an image
+	_Bit_view _louds;		// degrees of the nodes in breadth-first order, a one per child and a closing zero
+	_Bit_view _tails;		// a one for every node followed by a zero for each fragment after its first
+	_Bit_view _has_value;
+	std::span<const K> _keys;			// first fragment of every node
+	std::span<const K> _tail_fragments;	// the other fragments of compressed nodes
+	std::span<const V> _values;			// mapped values of the nodes having one, in node order
+
+}; // class frozen_trie
+
+} // namespace ltr
+
+#endif // LTR_FROZEN_TRIE
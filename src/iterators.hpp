@@ -6,6 +6,8 @@
 #include <utility>
 #include <iterator>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 #include "node.hpp"
 
@@ -31,6 +33,9 @@ public:
 	constexpr _Iterator_base() noexcept : node(nullptr) {}
 	constexpr _Iterator_base(const _Iterator_base& other) noexcept = default;
 	constexpr _Iterator_base(node_type* node) noexcept : node(node) {}
+	// iterators convert to const iterators
+	template<bool other_const, std::enable_if_t<is_const && !other_const, bool> = true>
+	constexpr _Iterator_base(const _Iterator_base<N, other_const, is_reverse>& other) noexcept : node(get_node(other)) {}
 	constexpr _Iterator_base& operator=(const _Iterator_base& other) noexcept = default;
 
 	reference operator*() {
@@ -170,6 +175,150 @@ private:
 	node_type* node;
 }; // class _Iterator_base
 
+// element handed out by iterators of tries not storing their keys
+// first is rebuilt from the fragments on the path, second refers to the stored mapped value
+template<typename Key,
+         typename Ref>	// reference to the mapped value
+struct _Key_value_ref {
+	using mapped_type = std::remove_cvref_t<Ref>;
+
+	Key first;
+	Ref second;
+
+	operator std::pair<const Key, mapped_type>() const {
+		return std::pair<const Key, mapped_type>(first, second);
+	}
+
+	friend bool operator==(const _Key_value_ref& lhs, const _Key_value_ref& rhs) {
+		return lhs.first == rhs.first && lhs.second == rhs.second;
+	}
+
+	friend bool operator<(const _Key_value_ref& lhs, const _Key_value_ref& rhs) {
+		return lhs.first < rhs.first || (!(rhs.first < lhs.first) && lhs.second < rhs.second);
+	}
+};
+
+// lets operator-> hand out the address of a temporary element
+template<typename R>
+struct _Arrow_proxy {
+	R ref;
+
+	R* operator->() noexcept {
+		return &ref;
+	}
+};
+
+// Bidirectional iterator class for tries rebuilding keys with their concatenation expression
+// traversal is the same as _Iterator_base, dereferencing yields a _Key_value_ref
+// the concatenation expression is the one held by the root the path leads to, so iterators survive moving and swapping tries
+template<typename N,	// associated node type
+         typename Key,
+         typename Concat,	// key concatenation expression type of the root, may be a reference
+         bool is_const,
+         bool is_reverse>
+class _Key_iterator {
+private:
+	using node_type  = N;
+	using base_type  = _Iterator_base<N, is_const, is_reverse>;
+	using mapped_ref = std::conditional_t<is_const, const typename N::value_type&, typename N::value_type&>;
+	using root_type  = _Root_node<N, Concat>;
+
+	// nodes of the deepest path key collects on the stack
+	static constexpr std::size_t path_stack = 32;
+public:
+	using difference_type   = std::ptrdiff_t;
+	using value_type        = std::pair<const Key, typename N::value_type>;
+	using reference         = _Key_value_ref<Key, mapped_ref>;
+	using pointer           = _Arrow_proxy<reference>;
+	using iterator_category = std::bidirectional_iterator_tag;
+
+	constexpr _Key_iterator() noexcept : base() {}
+	constexpr _Key_iterator(const _Key_iterator& other) noexcept = default;
+	constexpr _Key_iterator(node_type* node) noexcept : base(node) {}
+	template<bool other_const, std::enable_if_t<is_const && !other_const, bool> = true>
+	constexpr _Key_iterator(const _Key_iterator<N, Key, Concat, other_const, is_reverse>& other) noexcept : base(get_node(other)) {}
+	constexpr _Key_iterator& operator=(const _Key_iterator& other) noexcept = default;
+
+	reference operator*() const {
+		return reference{ key(), *(get_node(base)->value) };
+	}
+
+	pointer operator->() const {
+		return pointer{ **this };
+	}
+
+	friend bool operator==(const _Key_iterator& lhs, const _Key_iterator& rhs) {
+		return lhs.base == rhs.base;
+	}
+
+	friend bool operator!=(const _Key_iterator& lhs, const _Key_iterator& rhs) {
+		return !(lhs == rhs);
+	}
+
+	_Key_iterator& operator++() noexcept {
+		++base;
+		return *this;
+	}
+
+	_Key_iterator operator++(int) noexcept {
+		_Key_iterator old = *this;
+		++base;
+		return old;
+	}
+
+	_Key_iterator& operator--() noexcept {
+		--base;
+		return *this;
+	}
+
+	_Key_iterator operator--(int) noexcept {
+		_Key_iterator old = *this;
+		--base;
+		return old;
+	}
+
+	constexpr friend node_type* get_node(const _Key_iterator& it) noexcept {
+		return get_node(it.base);
+	}
+
+	// concatenates the fragments on the path from the root to the current node
+	Key key() const {
+		Key result;
+		append_path(result, get_node(base));
+		return result;
+	}
+
+private:
+	// appends the fragments on the path from the root down to node to result
+	// the depth is counted first, then the path is filled in bottom-up, on the stack for paths of up to path_stack nodes
+	// and in one allocation for deeper ones, so the stack taken doesn't grow with the key
+	static void append_path(Key& result, const node_type* node) {
+		std::size_t depth = 0;
+		const node_type* top = node;
+		for (; top->parent != nullptr; top = top->parent)
+			++depth;
+		const node_type* stacked[path_stack];
+		std::vector<const node_type*> allocated;
+		const node_type** path = stacked;
+		if (depth > path_stack) {
+			allocated.resize(depth);
+			path = allocated.data();
+		}
+		for (std::size_t i = depth; i > 0; node = node->parent)
+			path[--i] = node;
+		const root_type* root = static_cast<const root_type*>(top);
+		for (std::size_t i = 0; i < depth; ++i) {
+			for (std::size_t j = 0; j < path[i]->length(); ++j)
+				root->concat(result, path[i]->fragment(j));
+		}
+	}
+
+	template<typename, typename, typename, bool, bool>
+	friend class _Key_iterator;
+
+	base_type base;
+}; // class _Key_iterator
+
 template<typename N>
 struct consted_type<N, true> {
 	using val = const typename N::value_type;
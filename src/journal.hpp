@@ -0,0 +1,373 @@
+#pragma once
+
+#ifndef LTR_JOURNAL
+#define LTR_JOURNAL
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.hpp"
+
+namespace ltr {
+
+// write-ahead journal of the changes made to a trie through it, for recovering the trie after a crash
+// every insert, insert_or_assign, erase and clear is applied to the trie and appended to the file as a record,
+// records are buffered and written and synced in groups, so a crash loses at most the changes since the last commit
+// opening a journal replays its file into the trie, compact folds the file into one record per element
+// fragments and mapped values are stored as raw bytes, like in frozen trie images
+template<typename Trie>		// associated trie type
+class journal {
+private:
+	using fragment_type = typename Trie::key_type::value_type;
+
+	static_assert(std::is_trivially_copyable_v<fragment_type> && std::is_trivially_copyable_v<typename Trie::mapped_type>,
+	              "journals store fragments and mapped values as raw bytes");
+
+	// a record is a tag, the key's length as a varint, the key's fragments, the mapped value for inserts and assignments,
+	// and a checksum of all of these, which tells where a record torn by a crash starts
+	enum _Record : unsigned char {
+		insert_record = 1,
+		assign_record = 2,
+		erase_record  = 3,
+		clear_record  = 4,
+	};
+
+	static constexpr char journal_magic[8] = { 'l', 't', 'r', 'j', 'r', 'n', 'l', '1' };
+	static constexpr std::size_t header_size = sizeof(journal_magic) + 2 * sizeof(std::uint32_t);
+
+public:
+	using key_type    = typename Trie::key_type;
+	using mapped_type = typename Trie::mapped_type;
+	using value_type  = typename Trie::value_type;
+	using size_type   = typename Trie::size_type;
+	using iterator    = typename Trie::iterator;
+
+	// replays the file at path into trie, creating the file if there's none
+	// a record torn by a crash ends the replay and is cut off the file
+	// throws std::invalid_argument if the file isn't a journal of the same fragment and mapped types, std::runtime_error on io errors
+	journal(Trie& trie, const std::string& path, size_type group_size = 64) : trie(trie), path(path), file(nullptr), records(0), group_size(group_size) {
+		std::size_t valid = std::filesystem::exists(path) ? replay() : 0;
+		if (valid == 0) {
+			open("wb");
+			write_header(file, path);
+			sync();
+		}
+		else {
+			if (valid < std::filesystem::file_size(path))
+				std::filesystem::resize_file(path, valid);
+			open("ab");
+		}
+	}
+
+	journal(const journal& other) = delete;
+	journal& operator=(const journal& other) = delete;
+
+	// commits the pending records
+	~journal() {
+		try {
+			commit();
+		}
+		catch (...) {}
+		if (file)
+			std::fclose(file);
+	}
+
+	// ----------------- modifiers -----------------
+
+	std::pair<iterator, bool> insert(const value_type& value) {
+		std::pair<iterator, bool> result = trie.insert(value);
+		if (result.second)
+			append(insert_record, value.first, &value.second);
+		return result;
+	}
+
+	template<typename M>
+	std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj) {
+		std::pair<iterator, bool> result = trie.insert_or_assign(key, std::forward<M>(obj));
+		append(assign_record, key, &result.first->second);
+		return result;
+	}
+
+	size_type erase(const key_type& key) {
+		size_type erased = trie.erase(key);
+		if (erased)
+			append(erase_record, key, nullptr);
+		return erased;
+	}
+
+	void clear() {
+		trie.clear();
+		append(clear_record, key_type(), nullptr);
+	}
+
+	// ------------------ commits ------------------
+
+	// writes the pending records and syncs them to the disk
+	// if that fails the file is cut back to the last commit and the records stay pending for the next one,
+	// part of them left in front of it would read as a torn record and end the replay there
+	void commit() {
+		if (buffer.empty())
+			return;
+		// a failed compact or cut can leave no file to write to
+		if (!file)
+			throw std::runtime_error("cannot write " + path);
+		std::uintmax_t committed = std::filesystem::file_size(path);
+		try {
+			write_buffer(file, path);
+			sync();
+		}
+		catch (...) {
+			// closing flushes whatever stdio still holds, which is cut off along with the rest
+			std::fclose(std::exchange(file, nullptr));
+			std::error_code error;
+			std::filesystem::resize_file(path, committed, error);
+			if (!error)
+				file = std::fopen(path.c_str(), "ab");
+			throw;
+		}
+		buffer.clear();
+		records = 0;
+	}
+
+	// number of records not committed yet
+	size_type pending() const noexcept {
+		return records;
+	}
+
+	// rewrites the file as one insert record per element of the trie, in order, so it replays as a bulk load
+	// the new file replaces the old one once it's synced, and the directory is synced after the rename,
+	// a crash in between leaves the old one, any error leaves the journal appending to the old one
+	void compact() {
+		commit();
+		std::string next_path = path + ".compact";
+		std::FILE* next = std::fopen(next_path.c_str(), "wb");
+		if (!next)
+			throw std::runtime_error("cannot open " + next_path);
+		_Compaction guard{ *this, next, next_path };
+		write_header(next, next_path);
+		for (const auto& [key, value] : trie) {
+			append_record(insert_record, key, &value);
+			if (buffer.size() >= (std::size_t(1) << 16)) {
+				write_buffer(next, next_path);
+				buffer.clear();
+			}
+		}
+		write_buffer(next, next_path);
+		buffer.clear();
+		if (std::fflush(next) != 0 || !sync_file(next))
+			throw std::runtime_error("cannot sync " + next_path);
+		if (std::fclose(std::exchange(guard.next, nullptr)) != 0)
+			throw std::runtime_error("cannot write " + next_path);
+		// open files can't be replaced everywhere, the guard reopens the old one if the rename fails
+		std::fclose(std::exchange(file, nullptr));
+		std::filesystem::rename(next_path, path);
+		guard.replaced = true;
+		sync_directory();
+		open("ab");
+	}
+
+private:
+	void open(const char* mode) {
+		file = std::fopen(path.c_str(), mode);
+		if (!file)
+			throw std::runtime_error("cannot open " + path);
+	}
+
+	// undoes an unfinished compact, the buffered records and the new file are dropped and the file is reopened
+	struct _Compaction {
+		journal& owner;
+		std::FILE* next;
+		const std::string& next_path;
+		bool replaced = false;
+
+		~_Compaction() {
+			owner.buffer.clear();
+			if (next)
+				std::fclose(next);
+			if (!replaced) {
+				std::error_code ignored;
+				std::filesystem::remove(next_path, ignored);
+			}
+			if (!owner.file)
+				owner.file = std::fopen(owner.path.c_str(), "ab");
+		}
+	};
+
+	void write_header(std::FILE* to, const std::string& name) {
+		unsigned char header[header_size];
+		std::uint32_t sizes[2] = { sizeof(fragment_type), sizeof(mapped_type) };
+		std::memcpy(header, journal_magic, sizeof(journal_magic));
+		std::memcpy(header + sizeof(journal_magic), sizes, sizeof(sizes));
+		if (std::fwrite(header, 1, header_size, to) != header_size)
+			throw std::runtime_error("cannot write " + name);
+	}
+
+	void write_buffer(std::FILE* to, const std::string& name) {
+		if (std::fwrite(buffer.data(), 1, buffer.size(), to) != buffer.size())
+			throw std::runtime_error("cannot write " + name);
+	}
+
+	void sync() {
+		if (std::fflush(file) != 0 || !sync_file(file))
+			throw std::runtime_error("cannot sync " + path);
+	}
+
+	// makes a rename in the directory of the file durable, windows has no way to sync a directory and journals it anyway
+	void sync_directory() const {
+#ifndef _WIN32
+		std::filesystem::path directory = std::filesystem::path(path).parent_path();
+		int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+		bool synced = fd >= 0 && ::fsync(fd) == 0;
+		if (fd >= 0)
+			::close(fd);
+		if (!synced)
+			throw std::runtime_error("cannot sync the directory of " + path);
+#endif
+	}
+
+	static bool sync_file(std::FILE* f) noexcept {
+#ifdef _WIN32
+		return _commit(_fileno(f)) == 0;
+#else
+		return ::fsync(fileno(f)) == 0;
+#endif
+	}
+
+	// buffers the record, committing the group once it's full
+	void append(_Record tag, const key_type& key, const mapped_type* value) {
+		append_record(tag, key, value);
+		if (++records >= group_size)
+			commit();
+	}
+
+	void append_record(_Record tag, const key_type& key, const mapped_type* value) {
+		std::size_t start = buffer.size();
+		buffer.push_back(tag);
+		for (std::uint64_t length = key.size(); ; length >>= 7) {
+			if (length < 0x80) {
+				buffer.push_back(static_cast<unsigned char>(length));
+				break;
+			}
+			buffer.push_back(static_cast<unsigned char>(length | 0x80));
+		}
+		const unsigned char* fragments = reinterpret_cast<const unsigned char*>(key.data());
+		buffer.insert(buffer.end(), fragments, fragments + key.size() * sizeof(fragment_type));
+		if (value) {
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(value);
+			buffer.insert(buffer.end(), bytes, bytes + sizeof(mapped_type));
+		}
+		std::uint32_t sum = checksum(std::span<const unsigned char>(buffer).subspan(start));
+		const unsigned char* sum_bytes = reinterpret_cast<const unsigned char*>(&sum);
+		buffer.insert(buffer.end(), sum_bytes, sum_bytes + sizeof(sum));
+	}
+
+	// 32 bit FNV-1a
+	static std::uint32_t checksum(std::span<const unsigned char> bytes) noexcept {
+		std::uint32_t hash = 2166136261u;
+		for (unsigned char byte : bytes)
+			hash = (hash ^ byte) * 16777619u;
+		return hash;
+	}
+
+	// applies the records of the file to the trie, returns the size of the valid part, 0 if there's not even a header
+	// runs of inserts are collected and inserted as a range, which appends keys in order along the rightmost path
+	std::size_t replay() {
+		const mapped_file mapped(path);
+		std::span<const std::byte> bytes = mapped.bytes();
+		// a crash while creating the file can leave part of the header
+		if (bytes.size() < header_size)
+			return 0;
+		unsigned char header[header_size];
+		std::uint32_t sizes[2];
+		std::memcpy(header, bytes.data(), header_size);
+		std::memcpy(sizes, header + sizeof(journal_magic), sizeof(sizes));
+		if (std::memcmp(header, journal_magic, sizeof(journal_magic)) != 0 || sizes[0] != sizeof(fragment_type) || sizes[1] != sizeof(mapped_type))
+			throw std::invalid_argument("invalid trie journal");
+
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(bytes.data());
+		std::size_t size = bytes.size();
+		std::size_t valid = header_size;
+		std::vector<std::pair<key_type, mapped_type>> run;
+		while (valid < size) {
+			// a record cut short or failing its checksum is where a crash tore the file
+			std::size_t start = valid;
+			std::size_t pos = start;
+			unsigned char tag = data[pos++];
+			std::uint64_t length = 0;
+			bool complete = false;
+			for (unsigned shift = 0; pos < size && shift < 64; shift += 7) {
+				unsigned char byte = data[pos++];
+				length |= std::uint64_t(byte & 0x7f) << shift;
+				if (!(byte & 0x80)) {
+					complete = true;
+					break;
+				}
+			}
+			bool valued = tag == insert_record || tag == assign_record;
+			if (!complete || tag < insert_record || tag > clear_record || length > (size - pos) / sizeof(fragment_type))
+				break;
+			std::size_t end = pos + length * sizeof(fragment_type) + (valued ? sizeof(mapped_type) : 0);
+			if (end + sizeof(std::uint32_t) > size)
+				break;
+			std::uint32_t sum;
+			std::memcpy(&sum, data + end, sizeof(sum));
+			if (sum != checksum(std::span<const unsigned char>(data + start, end - start)))
+				break;
+
+			key_type key(length, fragment_type());
+			std::memcpy(key.data(), data + pos, length * sizeof(fragment_type));
+			mapped_type value{};
+			if (valued)
+				std::memcpy(&value, data + pos + length * sizeof(fragment_type), sizeof(mapped_type));
+			valid = end + sizeof(std::uint32_t);
+
+			if (tag == insert_record) {
+				run.emplace_back(std::move(key), value);
+				continue;
+			}
+			flush(run);
+			if (tag == assign_record)
+				trie.insert_or_assign(key, value);
+			else if (tag == erase_record)
+				trie.erase(key);
+			else
+				trie.clear();
+		}
+		flush(run);
+		return valid;
+	}
+
+	void flush(std::vector<std::pair<key_type, mapped_type>>& run) {
+		trie.insert(std::make_move_iterator(run.begin()), std::make_move_iterator(run.end()));
+		run.clear();
+	}
+
+	Trie& trie;
+	std::string path;
+	std::FILE* file;
+	std::vector<unsigned char> buffer;	// records not written yet
+	size_type records;					// number of records in buffer
+	size_type group_size;
+
+}; // class journal
+
+} // namespace ltr
+
+#endif // LTR_JOURNAL
@@ -0,0 +1,121 @@
+#pragma once
+
+#ifndef LTR_MAPPED_FILE
+#define LTR_MAPPED_FILE
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ltr {
+
+// read-only memory mapping of a whole file, for viewing trie images without reading them in
+// pages are loaded on first access and shared with every other process mapping the same file
+class mapped_file {
+public:
+	// throws std::runtime_error if the file can't be opened or mapped
+	explicit mapped_file(const std::string& path) : data(nullptr), length(0) {
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("cannot open " + path);
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size)) {
+			CloseHandle(file);
+			throw std::runtime_error("cannot map " + path);
+		}
+		length = static_cast<std::size_t>(size.QuadPart);
+		// empty files can't be mapped, they're viewed as an empty span
+		if (length > 0) {
+			HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping)
+				data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			// the view keeps the mapping alive
+			if (mapping)
+				CloseHandle(mapping);
+		}
+		CloseHandle(file);
+#else
+		int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0)
+			throw std::runtime_error("cannot open " + path);
+		struct stat info;
+		if (::fstat(file, &info) != 0) {
+			::close(file);
+			throw std::runtime_error("cannot map " + path);
+		}
+		length = static_cast<std::size_t>(info.st_size);
+		// empty files can't be mapped, they're viewed as an empty span
+		if (length > 0) {
+			void* address = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, file, 0);
+			if (address != MAP_FAILED)
+				data = static_cast<const std::byte*>(address);
+		}
+		// the mapping stays valid after the descriptor is closed
+		::close(file);
+#endif
+		if (length > 0 && !data)
+			throw std::runtime_error("cannot map " + path);
+	}
+
+	mapped_file(const mapped_file& other) = delete;
+	mapped_file(mapped_file&& other) noexcept : data(std::exchange(other.data, nullptr)), length(std::exchange(other.length, 0)) {}
+	mapped_file& operator=(const mapped_file& other) = delete;
+
+	mapped_file& operator=(mapped_file&& other) noexcept {
+		if (this != &other) {
+			unmap();
+			data = std::exchange(other.data, nullptr);
+			length = std::exchange(other.length, 0);
+		}
+		return *this;
+	}
+
+	~mapped_file() {
+		unmap();
+	}
+
+	// the file's contents, page aligned
+	std::span<const std::byte> bytes() const noexcept {
+		return std::span<const std::byte>(data, length);
+	}
+
+	std::size_t size() const noexcept {
+		return length;
+	}
+
+private:
+	void unmap() noexcept {
+		if (!data)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		::munmap(const_cast<std::byte*>(data), length);
+#endif
+		data = nullptr;
+		length = 0;
+	}
+
+	const std::byte* data;
+	std::size_t length;
+
+}; // class mapped_file
+
+} // namespace ltr
+
+#endif // LTR_MAPPED_FILE
@@ -5,78 +5,218 @@
 
 #include <utility>
 #include <memory>
+#include <type_traits>
+#include <ranges>
 #include <optional>
+#include <vector>
+#include <cassert>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+#include "child_index.hpp"
 
 namespace ltr {
 
+// hints the cache to load the memory at p, used to overlap the node misses of independent lookups
+inline void _prefetch(const void* p) noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(p);
+#endif
+}
+
+template<typename C, typename = void>
+inline constexpr bool _is_transparent = false;
+
+template<typename C>
+inline constexpr bool _is_transparent<C, std::void_t<typename C::is_transparent>> = true;
+
+// contiguous ranges of fragments, like string views, spans and arrays
+template<typename R, typename K>
+concept _Fragment_range = std::ranges::contiguous_range<const R&> &&
+                          std::is_same_v<std::ranges::range_value_t<const R&>, K>;
+
+// node layouts, selected through the last template parameter of trie
+enum trie_layout : unsigned {
+	default_layout   = 0,
+	// chains of single child nodes without a value are collapsed into one node holding a fragment sequence
+	path_compression = 1u << 0,
+	// nodes only store the mapped value, keys are rebuilt from the fragments when iterating
+	implicit_keys    = 1u << 1,
+};
+
+constexpr trie_layout operator|(trie_layout lhs, trie_layout rhs) noexcept {
+	return static_cast<trie_layout>(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+}
+
+// stand-in for the fragment sequence of uncompressed nodes
+struct _No_tail {
+	static constexpr std::size_t size() noexcept { return 0; }
+};
+
 template<typename K,
 		 typename V,
-		 template <typename T> typename Alloc>
+		 template <typename T> typename Alloc,
+		 trie_layout Layout = default_layout>
 struct _Node {
 
-	using allocator_type   = Alloc<_Node>;
-	using allocator_traits = std::allocator_traits<allocator_type>;
+	static constexpr bool compressed = (Layout & path_compression) != 0;
+
 	using key_type         = K;
 	using value_type       = V;
-
-	static allocator_type node_allocator;
+	using index_type       = _Child_index<K, _Node, Alloc>;
+	using index_allocator  = std::allocator_traits<Alloc<index_type>>;
+	using tail_type        = std::conditional_t<compressed, std::vector<K, Alloc<K>>, _No_tail>;
 
 	_Node* parent, * child, * prev, * next;
+	// only present while the node has more than index_type::list_limit children
+	index_type* index;
+	// first fragment of the node, siblings are ordered and indexed by it
 	K key;
+	// fragments following key in a compressed node
+	[[no_unique_address]] tail_type tail;
 	std::optional<value_type> value;
+	// number of values in the subtree, this node's own value included
+	std::size_t weight;
 
-	constexpr _Node() noexcept(noexcept(K())) : parent(nullptr), prev(nullptr), next(nullptr), child(nullptr), key() {}
+	constexpr _Node() noexcept(noexcept(K())) : parent(nullptr), child(nullptr), prev(nullptr), next(nullptr), index(nullptr), key(), weight(0) {}
 	constexpr _Node(_Node&& other) = delete;
 
-	// recursively create a deep copy of the node's subtree
-	_Node(const _Node& other) : key(other.key), value(other.value), parent(nullptr),
-		                        prev(nullptr), next(nullptr), child(nullptr)
-	{
-		if (other.child) {
-			_Node* prev_child = new _Node(*(other.child));
-			set_child(prev_child);
-
-			_Node* n = other.child->next;
-			while (n != nullptr) {
-				_Node* copy = new _Node(*n);
-				prev_child->set_next(copy);
-				prev_child = copy;
-				n = n->next;
-			}
-		}
-	}
+	// copies the fragments, the value and the weight only, links are left to the owning trie
+	_Node(const _Node& other) : parent(nullptr), child(nullptr), prev(nullptr), next(nullptr), index(nullptr),
+	                            key(other.key), tail(other.tail), value(other.value), weight(other.weight) {}
 
-	constexpr _Node(const K& key) : key(key), value(), parent(nullptr),
-		                            prev(nullptr), next(nullptr), child(nullptr) {}
+	constexpr _Node(const K& key) : parent(nullptr), child(nullptr), prev(nullptr), next(nullptr), index(nullptr),
+	                                key(key), value(), weight(0) {}
 
-	constexpr _Node(const K& key, const value_type& value) : key(key), value(std::in_place, value), parent(nullptr),
-										                     prev(nullptr), next(nullptr), child(nullptr) {}
+	constexpr _Node(const K& key, const value_type& value) : parent(nullptr), child(nullptr), prev(nullptr), next(nullptr), index(nullptr),
+	                                                         key(key), value(std::in_place, value), weight(1) {}
 
-	constexpr _Node(K&& key, value_type&& value): key(std::exchange(key, 0)), value(std::in_place, std::move(value)), parent(nullptr),
-										          prev(nullptr), next(nullptr), child(nullptr) {}
+	constexpr _Node(K&& key, value_type&& value) : parent(nullptr), child(nullptr), prev(nullptr), next(nullptr), index(nullptr),
+	                                               key(std::exchange(key, 0)), value(std::in_place, std::move(value)), weight(1) {}
 
-	// recursively destroy this node and its subtree
+	// the subtree is owned and destroyed by the trie
 	~_Node() {
-		_Node* n = child;
-		while (n != nullptr) {
-			_Node* tmp = n->next;
-			delete n;
-			n = tmp;
-		}
+		drop_index();
 	}
 
 	constexpr _Node& operator=(const _Node& other) = delete;
 	constexpr _Node& operator=(_Node&& other) = delete;
 
-	// new overload for convenient use
-	void* operator new (std::size_t size) {
-		void* p = allocator_traits::allocate(node_allocator, 1);
-		return p;
+	// number of fragments the node stands for
+	std::size_t length() const noexcept {
+		return 1 + tail.size();
+	}
+
+	const K& fragment(std::size_t i) const noexcept {
+		if constexpr (compressed)
+			return i == 0 ? key : tail[i - 1];
+		else
+			return key;
+	}
+
+	// returns the first child with a key not less than fragment, nullptr if there's none
+	template<typename Comp>
+	_Node* lower_child(const K& fragment, const Comp& comp) const {
+		if (index)
+			return index->lower(fragment, comp);
+		_Node* n = child;
+		while (n != nullptr && comp(n->key, fragment))
+			n = n->next;
+		return n;
+	}
+
+	// returns the child with a key equivalent to fragment, nullptr if there's none
+	template<typename Comp>
+	_Node* find_child(const K& fragment, const Comp& comp) const {
+		_Node* n = lower_child(fragment, comp);
+		if (n == nullptr || comp(fragment, n->key))
+			return nullptr;
+		return n;
+	}
+
+	_Node* last_child() const noexcept {
+		if (index)
+			return index->last();
+		_Node* n = child;
+		while (n != nullptr && n->next != nullptr)
+			n = n->next;
+		return n;
+	}
+
+	// sum of the weights of the children in front of c
+	template<typename Comp>
+	std::size_t weight_before(const _Node* c, const Comp& comp) const {
+		if (index)
+			return index->weight_before(c, weight - value.has_value(), comp);
+		std::size_t sum = 0;
+		for (const _Node* n = child; n != c; n = n->next)
+			sum += n->weight;
+		return sum;
+	}
+
+	// returns the child whose subtree holds the n-th value below the children,
+	// n is reduced by the weights of the children in front of it
+	_Node* child_at_weight(std::size_t& n) const noexcept {
+		if (index)
+			return index->find_weight(n);
+		_Node* c = child;
+		while (n >= c->weight) {
+			n -= c->weight;
+			c = c->next;
+		}
+		return c;
+	}
+
+	// adds delta to the weights on the path from this node up to the root
+	void add_weight(std::ptrdiff_t delta) noexcept {
+		std::size_t change = static_cast<std::size_t>(delta);
+		for (_Node* n = this; n != nullptr; n = n->parent) {
+			n->weight += change;
+			if (n->parent && n->parent->index)
+				n->parent->index->add_weight(n, change);
+		}
+	}
+
+	// links other as a child in front of pos, or as the last child if pos is nullptr
+	// pos is expected to be the result of lower_child for other's key
+	template<typename Comp>
+	void insert_child(_Node* other, _Node* pos, const Comp& comp) {
+		if (pos)
+			pos->set_prev(other);
+		else if (child)
+			last_child()->set_next(other);
+		else
+			set_child(other);
+
+#ifndef LTR_NO_CHILD_INDEX
+		if (index)
+			index->insert(other, comp);
+		else if (fanout() > index_type::list_limit)
+			index = make_index(false);
+#endif
 	}
 
-	// delete overload for convenient use
-	void operator delete (void * p) {
-		allocator_traits::deallocate(node_allocator, static_cast<_Node*>(p), 1);
+	// unlinks other from the children without destroying it
+	template<typename Comp>
+	void unlink_child(_Node* other, const Comp& comp) {
+		if (index) {
+			index->erase(other, comp);
+			if (index->size() < index_type::list_limit)
+				drop_index();
+		}
+
+		if (other->prev)
+			other->prev->next = other->next;
+		else
+			child = other->next;
+		if (other->next)
+			other->next->prev = other->prev;
+		other->prev = nullptr;
+		other->next = nullptr;
 	}
 
 	// should only be used if no children are present
@@ -109,58 +249,132 @@ struct _Node {
 		this->prev = other;
 	}
 
-	// function to remove this node and all nodes whose
+	// function to detach this node and all nodes whose
 	// only purpose was being a branch to this node
-	void remove_branch() {
+	// returns the top of the detached branch for the caller to destroy,
+	// its parent is left pointing to the node it was hanging from
+	template<typename Comp>
+	_Node* remove_branch(const Comp& comp) {
 		_Node* top = this;
 		this->value.reset();
 		// traverse towards root until found a node with having a sibling or a value
 		while (top->parent && !(top->prev) && !(top->next) && !(top->value.has_value()))
 			top = top->parent;
 
-		// set subtree-to-delete as copy's child to set them to be deleted at end of scope
-		_Node copy;
-		// if top has a value only delete its children
-		if (top->value.has_value()) {
-			copy.child = top->child;
-			top->child = nullptr;
-		}
-		// has right sibling
-		else if (top->next) {
-			// if top has 2 siblings, remove top from between
-			if (top->prev) {
-				top->prev->next = top->next;
-				top->next->prev = top->prev;
-				top->prev = nullptr;
-			}
-			// if only rightside sibling is present, set parent's child to it
-			else {
-				top->next->prev = nullptr;
-				top->parent->child = top->next;
-			}
-			top->next = nullptr;
-			copy.child = top;
-		}
-		// only left sibling
-		else if(top->prev) {
-			top->prev->next = nullptr;
-			top->prev = nullptr;
-			copy.child = top;
-		}
+		// if top has a value only detach its children
 		// top is root - can only occur if there was only 1 value present, hence top->child is always the node we came from
-		else {
-			copy.child = top->child;
+		if (top->value.has_value() || top->parent == nullptr) {
+			_Node* branch = top->child;
+			top->drop_index();
 			top->child = nullptr;
+			return branch;
+		}
+		// top has a sibling, unlink it from between them
+		top->parent->unlink_child(top, comp);
+		return top;
+	}
+
+	// splits off the first count fragments into top, a new node with the same key taking this node's place,
+	// this node becomes its only child keeping the value and the subtree
+	// returns top
+	template<typename Comp>
+	_Node* split(_Node* top, std::size_t count, const Comp& comp) {
+		top->tail.assign(tail.begin(), tail.begin() + (count - 1));
+		top->weight = weight;
+		replace_with(top, comp);
+		key = tail[count - 1];
+		tail.erase(tail.begin(), tail.begin() + count);
+		top->set_child(this);
+		return top;
+	}
+
+	// merges this value-less node into its only child, which takes its place
+	// this node is left detached for the caller to destroy, returns the child
+	template<typename Comp>
+	_Node* merge_into_child(const Comp& comp) {
+		assert(!value.has_value() && child && !child->next && parent);
+		_Node* bottom = child;
+		bottom->tail.insert(bottom->tail.begin(), bottom->key);
+		bottom->tail.insert(bottom->tail.begin(), tail.begin(), tail.end());
+		bottom->key = key;
+		child = nullptr;
+		bottom->parent = nullptr;
+		replace_with(bottom, comp);
+		return bottom;
+	}
+
+	// links other into this node's place along with the children, other must stand for the same fragments
+	// this node is left detached and without children, the value stays with it
+	// other takes over the weight as is, the caller accounts for a value moving in or out
+	template<typename Comp>
+	void exchange(_Node* other, const Comp& comp) {
+		other->child = std::exchange(child, nullptr);
+		other->index = std::exchange(index, nullptr);
+		other->weight = weight;
+		for (_Node* c = other->child; c != nullptr; c = c->next)
+			c->parent = other;
+		replace_with(other, comp);
+	}
+
+	// attaches an index mirroring the current sibling list
+	void build_index(bool direct) {
+		index = make_index(direct);
+	}
+
+	// detaches the index, the sibling list is left as is
+	void drop_index() {
+		if (index) {
+			Alloc<index_type> alloc;
+			index_allocator::destroy(alloc, index);
+			index_allocator::deallocate(alloc, index, 1);
+			index = nullptr;
 		}
 	}
 
+private:
+	// links other into this node's place among its siblings, other must have the same key
+	// this node is left detached from its parent and siblings
+	template<typename Comp>
+	void replace_with(_Node* other, const Comp& comp) {
+		other->parent = parent;
+		other->prev = prev;
+		other->next = next;
+		if (prev)
+			prev->next = other;
+		else
+			parent->child = other;
+		if (next)
+			next->prev = other;
+		if (parent->index)
+			parent->index->replace(this, other, comp);
+		parent = prev = next = nullptr;
+	}
+
+	std::size_t fanout() const noexcept {
+		std::size_t n = 0;
+		for (_Node* c = child; c != nullptr; c = c->next)
+			++n;
+		return n;
+	}
+
+	index_type* make_index(bool direct) {
+		Alloc<index_type> alloc;
+		index_type* p = index_allocator::allocate(alloc, 1);
+		index_allocator::construct(alloc, p, child, direct);
+		return p;
+	}
+
 }; // struct _Node
 
-// instantiate static allocator
-template<typename K,
-		 typename V,
-		 template<typename T> typename Alloc>
-typename _Node<K, V, Alloc>::allocator_type _Node<K, V, Alloc>::node_allocator;
+// the root node of a trie, which also holds the trie's key concatenation expression
+// iterators rebuilding keys reach it through the parent links, so they keep working after the trie is moved or swapped
+template<typename N,			// node type
+         typename Concat>	// key concatenation expression type, may be a reference
+struct _Root_node : N {
+	explicit _Root_node(const Concat& concat) : N(), concat(concat) {}
+
+	Concat concat;
+};
 
 } // namespace ltr
 
@@ -0,0 +1,407 @@
+#pragma once
+
+#ifndef LTR_OLC_TRIE
+#define LTR_OLC_TRIE
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "epoch.hpp"
+
+namespace ltr {
+
+// trie inserted into and read by any number of threads at once, elements are never erased
+// writers descend optimistically and lock only the node they change, through the version in every node:
+// the version read on the way down is upgraded into the lock with a compare and swap,
+// which fails if another writer changed the node meanwhile, so the writer reads the node again
+// and writers only wait on each other where their paths share the node being changed
+// nodes are never unlinked, so there's no coupling needed with the parent's version
+// a node's children are a sorted block of node pointers a writer inserts into in place, the block is only
+// replaced when it's full, by one twice the size, and the old one is retired through epochs
+// readers never lock, they search a node's children between two reads of its version and search again if it changed,
+// values are seen once they're published
+template<typename K,
+		 typename V,
+		 typename Concat_expr_t,
+		 template<typename T>    typename Comp   = std::less,
+		 template<typename SeqT, typename SeqTraits, typename SeqAlloc> typename Seq = std::basic_string,
+		 template<typename T>    typename Traits = std::char_traits,
+		 template<typename T>    typename Alloc  = std::allocator>
+class olc_trie {
+private:
+	struct _Olc_node;
+
+	// children sorted by fragment, only changed under the parent's lock
+	// the pointers are atomic as readers go through them while a writer shifts them, the fragments are the nodes' own
+	struct _Olc_children {
+		explicit _Olc_children(std::size_t capacity) : count(0), nodes(capacity) {}
+
+		std::size_t capacity() const noexcept {
+			return nodes.size();
+		}
+
+		std::atomic<std::size_t> count;
+		std::vector<std::atomic<_Olc_node*>, Alloc<std::atomic<_Olc_node*>>> nodes;
+	};
+
+	struct _Olc_node {
+		_Olc_node(const K& key) : version(0), key(key), children(nullptr), has_value(false) {}
+
+		std::atomic<std::uint64_t> version;		// odd while a writer holds the node
+		const K key;
+		std::atomic<_Olc_children*> children;
+		std::atomic<bool> has_value;
+		std::optional<V> value;					// set once, under the lock, before has_value
+	};
+
+	using node_traits     = std::allocator_traits<Alloc<_Olc_node>>;
+	using children_traits = std::allocator_traits<Alloc<_Olc_children>>;
+
+	// elements inserted by the threads pinned in a slot, on a cache line of their own
+	struct alignas(64) _Count {
+		std::atomic<std::size_t> value{ 0 };
+	};
+
+	// unpins the epoch slot on every way out
+	struct _Pin {
+		_Pin(_Epoch_domain& domain) noexcept : domain(domain), slot(domain.pin()) {}
+		~_Pin() { domain.unpin(slot); }
+
+		_Epoch_domain& domain;
+		std::size_t slot;
+	};
+
+public:
+	using key_type    = Seq<K, Traits<K>, Alloc<K>>;
+	using mapped_type = V;
+	using value_type  = std::pair<const key_type, V>;
+	using key_concat  = Concat_expr_t;
+	using size_type   = std::size_t;
+	using key_compare = Comp<K>;
+
+	// children a node starts out with room for
+	static constexpr std::size_t initial_capacity = 4;
+
+	olc_trie(const key_concat& concat, const key_compare& comp = key_compare()) : _concat(concat), _comp(comp), _root(make_node(K())) {}
+
+	olc_trie(const olc_trie& other) = delete;
+	olc_trie& operator=(const olc_trie& other) = delete;
+
+	// no other thread may use the trie by then
+	~olc_trie() {
+		std::vector<_Olc_node*> stack(1, _root);
+		while (!stack.empty()) {
+			_Olc_node* node = stack.back();
+			stack.pop_back();
+			if (_Olc_children* children = node->children.load()) {
+				for (std::size_t i = 0; i < children->count.load(); ++i)
+					stack.push_back(children->nodes[i].load());
+				free_children(children);
+			}
+			free_node(node);
+		}
+	}
+
+	// ----------------- capacity ------------------
+
+	// sums the counts of the slots, inserts going on meanwhile may or may not be counted
+	size_type size() const noexcept {
+		size_type sum = 0;
+		for (const _Count& count : _sizes)
+			sum += count.value.load(std::memory_order_relaxed);
+		return sum;
+	}
+
+	bool empty() const noexcept {
+		return size() == 0;
+	}
+
+	// ----------------- modifiers -----------------
+	// safe from any thread at any time
+
+	// inserts the element unless the key is there already, returns whether it was inserted
+	template<typename... Args>
+	bool try_emplace(const key_type& key, Args&&... args) {
+		if (key.empty())
+			throw std::invalid_argument("key must be of positive size");
+		_Pin pin(_domain);
+		_Olc_node* node = _root;
+		for (const K& fragment : key)
+			node = child_or_insert(node, fragment, pin.slot);
+
+		while (true) {
+			std::uint64_t version = read_version(node);
+			if (node->has_value.load())
+				return false;
+			if (!upgrade(node, version))
+				continue;
+			try {
+				node->value.emplace(std::forward<Args>(args)...);
+			}
+			catch (...) {
+				unlock(node);
+				throw;
+			}
+			node->has_value.store(true);
+			unlock(node);
+			_sizes[pin.slot].value.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	bool try_insert(const value_type& value) {
+		return try_emplace(value.first, value.second);
+	}
+
+	// ------------------ lookup -------------------
+	// safe from any thread at any time, found values stay valid as long as the trie
+
+	const mapped_type* find(const key_type& key) const {
+		if (key.empty())
+			throw std::invalid_argument("key must be of positive size");
+		_Pin pin(_domain);
+		const _Olc_node* node = _root;
+		for (const K& fragment : key) {
+			node = child(node, fragment);
+			if (!node)
+				return nullptr;
+		}
+		return node->has_value.load() ? &*node->value : nullptr;
+	}
+
+	bool contains(const key_type& key) const {
+		return find(key) != nullptr;
+	}
+
+	// calls f with the key and the mapped value of every element in order,
+	// elements inserted meanwhile may or may not be visited
+	template<typename F>
+	void for_each(F&& f) const {
+		_Pin pin(_domain);
+		// the children of every level are copied to pending while their parent's version held,
+		// the stack holds where each level starts and its next child to visit, the key is the fragments on the way down
+		std::vector<const _Olc_node*> pending;
+		std::vector<std::pair<std::size_t, std::size_t>> stack(1, { 0, 0 });
+		key_type key;
+		append_children(_root, pending);
+		while (!stack.empty()) {
+			auto& [start, next] = stack.back();
+			if (next == pending.size()) {
+				pending.resize(start);
+				stack.pop_back();
+				if (!stack.empty())
+					key.pop_back();
+				continue;
+			}
+			const _Olc_node* node = pending[next++];
+			_concat(key, node->key);
+			if (node->has_value.load())
+				f(static_cast<const key_type&>(key), static_cast<const V&>(*node->value));
+			std::size_t first = pending.size();
+			append_children(node, pending);
+			if (pending.size() > first)
+				stack.emplace_back(first, first);
+			else
+				key.pop_back();
+		}
+	}
+
+private:
+	// waits out a writer holding the node
+	static std::uint64_t read_version(const _Olc_node* node) noexcept {
+		while (true) {
+			std::uint64_t version = node->version.load();
+			if (!(version & 1))
+				return version;
+			std::this_thread::yield();
+		}
+	}
+
+	// locks the node if it hasn't changed since version was read
+	static bool upgrade(_Olc_node* node, std::uint64_t version) noexcept {
+		return node->version.compare_exchange_strong(version, version + 1);
+	}
+
+	static void unlock(_Olc_node* node) noexcept {
+		node->version.fetch_add(1);
+	}
+
+	// position of the first of count children not less than fragment
+	// the order may be torn by a writer shifting the children, the caller validates the version
+	std::size_t lower_child(const _Olc_children* children, std::size_t count, const K& fragment) const {
+		std::size_t first = 0;
+		while (count > 0) {
+			std::size_t half = count / 2;
+			if (_comp(children->nodes[first + half].load()->key, fragment)) {
+				first += half + 1;
+				count -= half + 1;
+			}
+			else
+				count = half;
+		}
+		return first;
+	}
+
+	// the child of node at fragment if there's one, along with the position it's at or would be at,
+	// searched while the version read before held
+	const _Olc_node* search(const _Olc_node* node, std::uint64_t version, const K& fragment, std::size_t& pos, bool& valid) const {
+		const _Olc_children* children = node->children.load();
+		const _Olc_node* found = nullptr;
+		pos = 0;
+		if (children) {
+			std::size_t count = children->count.load();
+			pos = lower_child(children, count, fragment);
+			if (pos < count) {
+				const _Olc_node* candidate = children->nodes[pos].load();
+				if (!_comp(fragment, candidate->key))
+					found = candidate;
+			}
+		}
+		valid = node->version.load() == version;
+		return found;
+	}
+
+	const _Olc_node* child(const _Olc_node* node, const K& fragment) const {
+		while (true) {
+			std::uint64_t version = read_version(node);
+			std::size_t pos;
+			bool valid;
+			const _Olc_node* found = search(node, version, fragment, pos, valid);
+			if (valid)
+				return found;
+		}
+	}
+
+	// appends the children of node as they were at one version to copied
+	void append_children(const _Olc_node* node, std::vector<const _Olc_node*>& copied) const {
+		std::size_t first = copied.size();
+		while (true) {
+			std::uint64_t version = read_version(node);
+			if (const _Olc_children* children = node->children.load()) {
+				std::size_t count = children->count.load();
+				for (std::size_t i = 0; i < count; ++i)
+					copied.push_back(children->nodes[i].load());
+			}
+			if (node->version.load() == version)
+				return;
+			copied.resize(first);
+		}
+	}
+
+	// the child of node at fragment, inserted in place into the node's children if it's not there,
+	// only a full block is replaced by a bigger copy
+	_Olc_node* child_or_insert(_Olc_node* node, const K& fragment, std::size_t slot) {
+		while (true) {
+			std::uint64_t version = read_version(node);
+			std::size_t pos;
+			bool valid;
+			const _Olc_node* found = search(node, version, fragment, pos, valid);
+			if (!valid)
+				continue;
+			if (found)
+				return const_cast<_Olc_node*>(found);
+			if (!upgrade(node, version))
+				continue;
+
+			// the version held, so the children and pos are the ones just searched
+			_Olc_children* children = node->children.load();
+			std::size_t count = children ? children->count.load() : 0;
+			_Olc_node* added = nullptr;
+			_Olc_children* grown = nullptr;
+			try {
+				added = make_node(fragment);
+				if (!children || count == children->capacity())
+					grown = make_children(children ? 2 * count : initial_capacity);
+			}
+			catch (...) {
+				if (added)
+					free_node(added);
+				unlock(node);
+				throw;
+			}
+			if (grown) {
+				for (std::size_t i = 0; i < pos; ++i)
+					grown->nodes[i].store(children->nodes[i].load(), std::memory_order_relaxed);
+				grown->nodes[pos].store(added, std::memory_order_relaxed);
+				for (std::size_t i = pos; i < count; ++i)
+					grown->nodes[i + 1].store(children->nodes[i].load(), std::memory_order_relaxed);
+				grown->count.store(count + 1);
+				node->children.store(grown);
+			}
+			else {
+				for (std::size_t i = count; i > pos; --i)
+					children->nodes[i].store(children->nodes[i - 1].load());
+				children->nodes[pos].store(added);
+				children->count.store(count + 1);
+			}
+			unlock(node);
+			if (grown && children)
+				_domain.retire(slot, children, &olc_trie::retire_children);
+			return added;
+		}
+	}
+
+	static _Olc_node* make_node(const K& key) {
+		Alloc<_Olc_node> alloc;
+		_Olc_node* node = node_traits::allocate(alloc, 1);
+		try {
+			node_traits::construct(alloc, node, key);
+		}
+		catch (...) {
+			node_traits::deallocate(alloc, node, 1);
+			throw;
+		}
+		return node;
+	}
+
+	static void free_node(_Olc_node* node) noexcept {
+		Alloc<_Olc_node> alloc;
+		node_traits::destroy(alloc, node);
+		node_traits::deallocate(alloc, node, 1);
+	}
+
+	static _Olc_children* make_children(std::size_t capacity) {
+		Alloc<_Olc_children> alloc;
+		_Olc_children* children = children_traits::allocate(alloc, 1);
+		try {
+			children_traits::construct(alloc, children, capacity);
+		}
+		catch (...) {
+			children_traits::deallocate(alloc, children, 1);
+			throw;
+		}
+		return children;
+	}
+
+	static void free_children(_Olc_children* children) noexcept {
+		Alloc<_Olc_children> alloc;
+		children_traits::destroy(alloc, children);
+		children_traits::deallocate(alloc, children, 1);
+	}
+
+	static void retire_children(void* children) noexcept {
+		free_children(static_cast<_Olc_children*>(children));
+	}
+
+	key_concat _concat;
+	const key_compare _comp;
+	mutable _Epoch_domain _domain;
+	_Olc_node* _root;
+	_Count _sizes[_Epoch_domain::slot_count];
+
+}; // class olc_trie
+
+} // namespace ltr
+
+#endif // LTR_OLC_TRIE
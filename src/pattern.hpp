@@ -0,0 +1,363 @@
+#pragma once
+
+#ifndef LTR_PATTERN
+#define LTR_PATTERN
+
+#include <utility>
+#include <string_view>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <map>
+#include <cstddef>
+
+namespace ltr {
+
+// syntaxes a pattern can be written in
+enum pattern_syntax : unsigned {
+	// a fragment matches itself, . any fragment, [abc], [a-z] and [^a-z] classes of fragments, \x the fragment x,
+	// x* x+ x? repetitions, a|b alternatives and ( ) groups
+	regex_syntax = 0,
+	// * any sequence of fragments, ? any fragment, [abc], [a-z] and [!a-z] (or [^a-z]) classes, \x the fragment x
+	glob_syntax  = 1,
+};
+
+// pattern matching whole keys, compiled to a nondeterministic automaton over fragments with
+// a state per fragment test and empty transitions between them, like in Thompson's construction
+// throws std::invalid_argument if the pattern is malformed
+template<typename K,
+		 template<typename T> typename Comp = std::less>
+class basic_pattern {
+	template<typename, template<typename> typename>
+	friend class _Pattern_automaton;
+
+public:
+	using key_type    = K;
+	using key_compare = Comp<K>;
+
+	explicit basic_pattern(std::basic_string_view<K> source, pattern_syntax syntax = regex_syntax) : source(source), position(0) {
+		_Piece piece = syntax == glob_syntax ? glob() : alternation();
+		if (position != source.size())
+			throw std::invalid_argument("unmatched ) in pattern");
+		states[piece.last].kind = _Kind::accept;
+		start = piece.first;
+		this->source = {};
+	}
+
+private:
+	enum class _Kind : unsigned char { empty, fragment, any, set, accept };
+
+	struct _State {
+		_Kind kind;
+		bool negated;
+		K low, high;	// the fragment, or the range of a set
+		// next state, or the next states of an empty one, npos if there's none
+		std::size_t out[2];
+		// further ranges of a set
+		std::vector<std::pair<K, K>> ranges;
+	};
+
+	// sub-automaton between first and an empty state last, whose transitions are still to be set
+	struct _Piece {
+		std::size_t first, last;
+	};
+
+	static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+	static constexpr K meta(char c) noexcept {
+		return static_cast<K>(c);
+	}
+
+	std::size_t add(_Kind kind, const K& fragment = K()) {
+		states.push_back(_State{ kind, false, fragment, fragment, { npos, npos }, {} });
+		return states.size() - 1;
+	}
+
+	// a fragment test followed by a new empty state
+	_Piece test(std::size_t state) {
+		std::size_t last = add(_Kind::empty);
+		states[state].out[0] = last;
+		return { state, last };
+	}
+
+	_Piece concat(_Piece lhs, _Piece rhs) {
+		states[lhs.last].out[0] = rhs.first;
+		return { lhs.first, rhs.last };
+	}
+
+	// repeats piece any number of times, at least once if more is set
+	_Piece repeat(_Piece piece, bool more) {
+		std::size_t first = add(_Kind::empty), last = add(_Kind::empty);
+		states[first].out[0] = piece.first;
+		states[first].out[1] = more ? npos : last;
+		states[piece.last].out[0] = piece.first;
+		states[piece.last].out[1] = last;
+		return { first, last };
+	}
+
+	_Piece either(_Piece lhs, _Piece rhs) {
+		std::size_t first = add(_Kind::empty), last = add(_Kind::empty);
+		states[first].out[0] = lhs.first;
+		states[first].out[1] = rhs.first;
+		states[lhs.last].out[0] = last;
+		states[rhs.last].out[0] = last;
+		return { first, last };
+	}
+
+	bool at(char c) const noexcept {
+		return position < source.size() && source[position] == meta(c);
+	}
+
+	// the fragment at position, or the one following a backslash
+	K literal() {
+		if (source[position] == meta('\\') && ++position == source.size())
+			throw std::invalid_argument("trailing \\ in pattern");
+		return source[position++];
+	}
+
+	// parses a class following [, the first of the negating fragments flips it
+	_Piece set(char negate, char also_negate) {
+		std::size_t state = add(_Kind::set);
+		states[state].negated = at(negate) || at(also_negate);
+		if (states[state].negated)
+			++position;
+		bool first = true;
+		for (; position < source.size() && (first || !at(']')); first = false) {
+			K low = literal(), high = low;
+			if (at('-') && position + 1 < source.size() && source[position + 1] != meta(']')) {
+				++position;
+				high = literal();
+			}
+			if (first) {
+				states[state].low = low;
+				states[state].high = high;
+			}
+			else
+				states[state].ranges.emplace_back(low, high);
+		}
+		if (position == source.size())
+			throw std::invalid_argument("unterminated [ in pattern");
+		++position;
+		return test(state);
+	}
+
+	_Piece glob() {
+		_Piece piece = test(add(_Kind::empty));
+		while (position < source.size()) {
+			if (at('*')) {
+				++position;
+				piece = concat(piece, repeat(test(add(_Kind::any)), false));
+			}
+			else if (at('?')) {
+				++position;
+				piece = concat(piece, test(add(_Kind::any)));
+			}
+			else if (at('[')) {
+				++position;
+				piece = concat(piece, set('!', '^'));
+			}
+			else
+				piece = concat(piece, test(add(_Kind::fragment, literal())));
+		}
+		return piece;
+	}
+
+	_Piece alternation() {
+		_Piece piece = sequence();
+		while (at('|')) {
+			++position;
+			piece = either(piece, sequence());
+		}
+		return piece;
+	}
+
+	_Piece sequence() {
+		_Piece piece = test(add(_Kind::empty));
+		while (position < source.size() && !at('|') && !at(')'))
+			piece = concat(piece, repetition());
+		return piece;
+	}
+
+	_Piece repetition() {
+		_Piece piece = atom();
+		while (at('*') || at('+') || at('?')) {
+			if (at('?')) {
+				std::size_t first = add(_Kind::empty);
+				states[first].out[0] = piece.first;
+				states[first].out[1] = piece.last;
+				piece.first = first;
+			}
+			else
+				piece = repeat(piece, at('+'));
+			++position;
+		}
+		return piece;
+	}
+
+	_Piece atom() {
+		if (at('*') || at('+') || at('?'))
+			throw std::invalid_argument("nothing to repeat in pattern");
+		if (at('(')) {
+			++position;
+			_Piece piece = alternation();
+			if (!at(')'))
+				throw std::invalid_argument("unmatched ( in pattern");
+			++position;
+			return piece;
+		}
+		if (at('.')) {
+			++position;
+			return test(add(_Kind::any));
+		}
+		if (at('[')) {
+			++position;
+			return set('^', '^');
+		}
+		return test(add(_Kind::fragment, literal()));
+	}
+
+	std::vector<_State> states;
+	std::size_t start;
+	// only used while parsing
+	std::basic_string_view<K> source;
+	std::size_t position;
+
+}; // class basic_pattern
+
+using pattern = basic_pattern<char>;
+
+// deterministic automaton built from a pattern while it's run, a state for each set of pattern states reached,
+// the transitions are only worked out on the first time they're taken and looked up afterwards
+template<typename K,
+		 template<typename T> typename Comp>
+class _Pattern_automaton {
+	using pattern_type = basic_pattern<K, Comp>;
+	using kind = typename pattern_type::_Kind;
+
+public:
+	// state no fragment sequence leads out of
+	static constexpr std::size_t dead = 0;
+
+	_Pattern_automaton(const pattern_type& pattern, const Comp<K>& comp) : pattern(pattern), comp(comp) {
+		intern({});
+		std::vector<std::size_t> initial;
+		close(pattern.start, initial);
+		first = intern(std::move(initial));
+	}
+
+	std::size_t start() const noexcept {
+		return first;
+	}
+
+	bool accepts(std::size_t state) const noexcept {
+		return states[state].accepting;
+	}
+
+	// the only fragment leading out of state, nullptr if there's more than one or any fragment does
+	const K* only(std::size_t state) const noexcept {
+		return states[state].single ? &pattern.states[states[state].set.front()].low : nullptr;
+	}
+
+	std::size_t next(std::size_t state, const K& fragment) {
+		auto found = states[state].transitions.find(fragment);
+		if (found != states[state].transitions.end())
+			return found->second;
+		std::vector<std::size_t> reached;
+		for (std::size_t s : states[state].set) {
+			if (matches(pattern.states[s], fragment))
+				close(pattern.states[s].out[0], reached);
+		}
+		std::size_t target = intern(std::move(reached));
+		states[state].transitions.emplace(fragment, target);
+		return target;
+	}
+
+private:
+	struct _State {
+		// pattern states testing a fragment or accepting, sorted
+		std::vector<std::size_t> set;
+		bool accepting;
+		// whether all states of the set test for the same fragment
+		bool single;
+		std::map<K, std::size_t, Comp<K>> transitions;
+	};
+
+	bool equivalent(const K& lhs, const K& rhs) const {
+		return !comp(lhs, rhs) && !comp(rhs, lhs);
+	}
+
+	bool within(const K& fragment, const K& low, const K& high) const {
+		return !comp(fragment, low) && !comp(high, fragment);
+	}
+
+	bool matches(const typename pattern_type::_State& s, const K& fragment) const {
+		switch (s.kind) {
+		case kind::fragment:
+			return equivalent(s.low, fragment);
+		case kind::any:
+			return true;
+		case kind::set: {
+			bool in = within(fragment, s.low, s.high);
+			for (auto it = s.ranges.begin(); !in && it != s.ranges.end(); ++it)
+				in = within(fragment, it->first, it->second);
+			return in != s.negated;
+		}
+		default:
+			return false;
+		}
+	}
+
+	// adds the states reachable from state through empty transitions, state included, to set
+	void close(std::size_t state, std::vector<std::size_t>& set) const {
+		std::vector<std::size_t> pending{ state };
+		while (!pending.empty()) {
+			std::size_t s = pending.back();
+			pending.pop_back();
+			if (s == pattern_type::npos)
+				continue;
+			const auto& current = pattern.states[s];
+			if (current.kind != kind::empty) {
+				if (std::find(set.begin(), set.end(), s) == set.end())
+					set.push_back(s);
+				continue;
+			}
+			// empty states of loops are reached again through the loop, their tests are already in
+			if (std::find(visited.begin(), visited.end(), s) != visited.end())
+				continue;
+			visited.push_back(s);
+			pending.push_back(current.out[1]);
+			pending.push_back(current.out[0]);
+		}
+		visited.clear();
+	}
+
+	std::size_t intern(std::vector<std::size_t>&& set) {
+		std::sort(set.begin(), set.end());
+		auto found = ids.find(set);
+		if (found != ids.end())
+			return found->second;
+		bool accepting = false, single = !set.empty();
+		for (std::size_t s : set) {
+			const auto& current = pattern.states[s];
+			accepting = accepting || current.kind == kind::accept;
+			single = single && current.kind == kind::fragment && equivalent(current.low, pattern.states[set.front()].low);
+		}
+		ids.emplace(set, states.size());
+		states.push_back(_State{ std::move(set), accepting, single, std::map<K, std::size_t, Comp<K>>(comp) });
+		return states.size() - 1;
+	}
+
+	const pattern_type& pattern;
+	Comp<K> comp;
+	std::vector<_State> states;
+	std::map<std::vector<std::size_t>, std::size_t> ids;
+	std::size_t first;
+	// empty states seen by the closure being worked out
+	mutable std::vector<std::size_t> visited;
+
+}; // class _Pattern_automaton
+
+} // namespace ltr
+
+#endif // LTR_PATTERN
@@ -10,9 +10,19 @@
 #include <initializer_list>
 #include <stdexcept>
 #include <algorithm>
+#include <iterator>
+#include <vector>
+#include <ranges>
+#include <map>
+#include <thread>
+#include <exception>
 
 #include "node.hpp"
+#include "arena.hpp"
 #include "iterators.hpp"
+#include "frozen_trie.hpp"
+#include "work_stealing.hpp"
+#include "pattern.hpp"
 
 namespace ltr {
 
@@ -22,8 +32,22 @@ template<typename K,
 		 template<typename T>    typename Comp   = std::less,
 		 template<typename SeqT, typename SeqTraits, typename SeqAlloc> typename Seq = std::basic_string,
 		 template<typename T>    typename Traits = std::char_traits,
-		 template<typename T>    typename Alloc  = std::allocator>
+		 template<typename T>    typename Alloc  = std::allocator,
+		 trie_layout Layout = default_layout>
 class trie {
+	static constexpr bool implicit = (Layout & implicit_keys) != 0;
+	// type of the nodes' values, keys are only stored there if they can't be rebuilt
+	using stored_type = std::conditional_t<implicit, V, std::pair<const Seq<K, Traits<K>, Alloc<K>>, V>>;
+	using arena_type  = _Node_arena<_Node<K, stored_type, Alloc, Layout>, Alloc>;
+	using root_type   = _Root_node<_Node<K, stored_type, Alloc, Layout>, Concat_expr_t>;
+	using root_traits = std::allocator_traits<Alloc<root_type>>;
+
+	// key types other than key_type are looked up fragment by fragment if they're contiguous ranges of fragments,
+	// any other one needs a transparent comparator working on whole keys
+	template<typename key_t, typename comp>
+	static constexpr bool heterogeneous = !std::is_convertible_v<key_t, Seq<K, Traits<K>, Alloc<K>>> &&
+	                                      (_Fragment_range<key_t, K> || (_is_transparent<comp> && std::is_default_constructible_v<comp>));
+
 public:
 
 	// ---------------- member types ---------------
@@ -36,20 +60,103 @@ public:
 	using difference_type        = std::ptrdiff_t;
 	using key_compare            = Comp<K>;
 	using allocator_type         = Alloc<value_type>;
-	using reference              = value_type&;
-	using const_reference        = const value_type&;
 	using pointer                = typename std::allocator_traits<allocator_type>::pointer;
 	using const__pointer         = typename std::allocator_traits<allocator_type>::const_pointer;
-	using node_type              = _Node<K, value_type, Alloc>;
-	using iterator               = _Iterator_base<node_type, false, false>;
-	using const_iterator         = _Iterator_base<node_type, true, false>;
-	using reverse_iterator       = _Iterator_base<node_type, false, true>;
-	using const_reverse_iterator = _Iterator_base<node_type, true, true>;
+	using node_type              = _Node<K, stored_type, Alloc, Layout>;
+	using iterator               = std::conditional_t<implicit, _Key_iterator<node_type, key_type, key_concat, false, false>,
+	                                                            _Iterator_base<node_type, false, false>>;
+	using const_iterator         = std::conditional_t<implicit, _Key_iterator<node_type, key_type, key_concat, true, false>,
+	                                                            _Iterator_base<node_type, true, false>>;
+	using reverse_iterator       = std::conditional_t<implicit, _Key_iterator<node_type, key_type, key_concat, false, true>,
+	                                                            _Iterator_base<node_type, false, true>>;
+	using const_reverse_iterator = std::conditional_t<implicit, _Key_iterator<node_type, key_type, key_concat, true, true>,
+	                                                            _Iterator_base<node_type, true, true>>;
+	// with implicit keys these are proxies holding the rebuilt key and a reference to the mapped value
+	using reference              = typename iterator::reference;
+	using const_reference        = typename const_iterator::reference;
+	using pattern_type           = basic_pattern<K, Comp>;
+
+	// owns an element extracted from a trie, without moving or copying it, until it's inserted into a trie again
+	// the node keeps its place in the slab of the trie it was extracted from, which the handle keeps alive,
+	// a handle destroyed without being inserted leaves that slot unused until the slab is freed with the last trie sharing it
+	// the handle holds a copy of the key, which the element is given when it's inserted
+	class node_handle {
+	public:
+		constexpr node_handle() noexcept : node(nullptr) {}
+		node_handle(const node_handle& other) = delete;
+		node_handle(node_handle&& other) noexcept : node(std::exchange(other.node, nullptr)), slab(std::move(other.slab)), held(std::move(other.held)) {}
+		node_handle& operator=(const node_handle& other) = delete;
+
+		node_handle& operator=(node_handle&& other) noexcept {
+			if (this != &other) {
+				reset();
+				node = std::exchange(other.node, nullptr);
+				slab = std::move(other.slab);
+				held = std::move(other.held);
+			}
+			return *this;
+		}
+
+		// the element is destroyed, its slot is only reused once the slab is freed
+		~node_handle() {
+			reset();
+		}
+
+		[[nodiscard]] bool empty() const noexcept {
+			return node == nullptr;
+		}
+
+		explicit operator bool() const noexcept {
+			return node != nullptr;
+		}
+
+		// the key the element is inserted with, it may be changed like the key of std::map's node handles
+		key_type& key() const {
+			return held;
+		}
+
+		mapped_type& mapped() const {
+			return trie::mapped(node);
+		}
+
+		void swap(node_handle& other) noexcept {
+			std::swap(node, other.node);
+			slab.swap(other.slab);
+			held.swap(other.held);
+		}
+
+		friend void swap(node_handle& lhs, node_handle& rhs) noexcept {
+			lhs.swap(rhs);
+		}
+
+	private:
+		friend class trie;
+
+		node_handle(node_type* node, std::shared_ptr<void> slab, key_type&& held) noexcept : node(node), slab(std::move(slab)), held(std::move(held)) {}
+
+		void reset() noexcept {
+			if (node) {
+				node->~node_type();
+				node = nullptr;
+				slab.reset();
+			}
+		}
+
+		node_type* node;
+		std::shared_ptr<void> slab;
+		mutable key_type held;	// the element's key, copied or rebuilt when extracted
+	};
+
+	struct insert_return_type {
+		iterator position;
+		bool inserted;
+		node_handle node;
+	};
 
 	// ----------- ctors and assignment ------------
 
 	constexpr trie() noexcept = delete;
-	trie(const key_concat& concat, const key_compare& comp = key_compare()) : _concat(concat), _comp(comp), _root(new node_type()) {}
+	trie(const key_concat& concat, const key_compare& comp = key_compare()) : _concat(concat), _root(make_root(concat)), _comp(comp) {}
 
 	template<typename InputIt>
 	trie(const key_concat& concat,
@@ -58,8 +165,17 @@ public:
 	{
 		insert(first, last);
 	}
-	trie(const trie& other) : _root(new node_type(*(other._root))), _concat(other._concat), _comp(other._comp) {}
-	trie(trie&& other) noexcept : _root(other._root), _concat(std::move(other._concat)), _comp(std::move(other._comp)) { other._root = nullptr; }
+	trie(const trie& other) : _concat(other._concat), _root(make_root(other._concat)), _comp(other._comp) {
+		try {
+			copy_children(other._root, _root, other._arena.size());
+		}
+		catch (...) {
+			destroy_children(false);
+			free_root(_root);
+			throw;
+		}
+	}
+	trie(trie&& other) noexcept : _concat(std::move(other._concat)), _root(other._root), _comp(std::move(other._comp)), _arena(std::move(other._arena)) { other._root = nullptr; }
 	trie(std::initializer_list<value_type> init,
 		const key_concat& concat,
 		const key_compare& comp = key_compare()) : trie(concat, comp)
@@ -69,34 +185,41 @@ public:
 
 	~trie() {
 		// need nullptr check in case _root was taken by move
-		if (_root)
-			delete _root;
+		if (_root) {
+			destroy_children(false);
+			free_root(_root);
+		}
+		// the arena releases the slabs when destroyed
 	}
 
 	trie& operator=(const trie& other) {
 		if (this != &other) {
-			delete _root;
+			reset();
 
 			// no need to copy _comp and _concat as the matching type ensures they are the same
-			_root = new node_type(*(other._root));
+			copy_children(other._root, _root, other._arena.size());
 		}
 		return *this;
 	}
 
 	trie& operator=(trie&& other) noexcept {
 		if (this != &other) {
-			delete _root;
+			if (_root) {
+				destroy_children(false);
+				free_root(_root);
+			}
+			_arena.release();
 
 			// no need to take _comp and _concat as the matching type ensures they are the same
 			_root = other._root;
 			other._root = nullptr;
+			_arena.swap(other._arena);
 		}
 		return *this;
 	}
 
 	trie& operator=(std::initializer_list<value_type> init) {
-		delete _root;
-		_root = new node_type();
+		reset();
 		insert(init);
 		return *this;
 	}
@@ -108,7 +231,7 @@ public:
 		if (!result.second)
 			throw std::out_of_range("invalid trie key");
 
-		return result.first->value->second;
+		return mapped(result.first);
 	}
 
 	const mapped_type& at(const key_type& key) const {
@@ -116,83 +239,83 @@ public:
 		if (!result.second)
 			throw std::out_of_range("invalid trie key");
 
-		return result.first->value->second;
+		return mapped(result.first);
 	}
 
 	mapped_type& operator[](const key_type& key) {
 		node_type* target = try_insert(key);
 		if (!(target->value.has_value()))
-			target->value.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>());
-		return target->value->second;
+			construct_value(target, key);
+		return mapped(target);
 	}
 
 	mapped_type& operator[](key_type&& key) {
 		node_type* target = try_insert(key);
 		if (!(target->value.has_value()))
-			target->value.emplace(std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::tuple<>());
-		return target->value->second;
+			construct_value(target, std::move(key));
+		return mapped(target);
 	}
 
 	// ----------------- iterators -----------------
 
 	iterator begin() noexcept {
-		iterator it(_root);
+		iterator it = wrap<iterator>(_root);
 		++it;
 		return it;
 	}
 
 	const_iterator begin() const noexcept {
-		const_iterator it(_root);
+		const_iterator it = wrap<const_iterator>(_root);
 		++it;
 		return it;
 	}
 
 	const_iterator cbegin() const noexcept {
-		const_iterator it(_root);
+		const_iterator it = wrap<const_iterator>(_root);
 		++it;
 		return it;
 	}
 
 	reverse_iterator rbegin() noexcept {
-		reverse_iterator it(_root);
+		reverse_iterator it = wrap<reverse_iterator>(_root);
 		++it;
 		return it;
 	}
 
 	const_reverse_iterator rbegin() const noexcept {
-		const_reverse_iterator it(_root);
+		const_reverse_iterator it = wrap<const_reverse_iterator>(_root);
 		++it;
 		return it;
 	}
 
 	const_reverse_iterator crbegin() const noexcept {
-		const_reverse_iterator it(_root);
+		const_reverse_iterator it = wrap<const_reverse_iterator>(_root);
 		++it;
 		return it;
 	}
 
 	constexpr iterator end() noexcept {
-		return iterator(_root);
+		return wrap<iterator>(_root);
 	}
 
 	constexpr const_iterator end() const noexcept {
-		return const_iterator(_root);
+		return wrap<const_iterator>(_root);
 	}
 
 	constexpr const_iterator cend() const noexcept {
-		return const_iterator(_root);
+		return wrap<const_iterator>(_root);
 	}
 
 	constexpr reverse_iterator rend() noexcept {
-		return reverse_iterator(_root);
+		return wrap<reverse_iterator>(_root);
 	}
 
 	constexpr const_reverse_iterator rend() const noexcept {
-		return const_reverse_iterator(_root);
+		return wrap<const_reverse_iterator>(_root);
 	}
 
 	constexpr const_reverse_iterator crend() const noexcept {
-		return const_reverse_iterator(_root);
+		return wrap<const_reverse_iterator>(_root);
 	}
 
 	// ----------------- capacity ------------------
@@ -201,26 +324,26 @@ public:
 		return _root->child == nullptr;
 	}
 
-	size_type size() const {
-		return std::distance(begin(), end());
+	// every node counts the values in its subtree, so the root holds the size
+	size_type size() const noexcept {
+		return _root->weight;
 	}
 
 	// ----------------- modifiers -----------------
 
 	void clear() {
-		node_type copy;
-		// dtor called at end of scope will destroy the tree below the root
+		// destroy the tree below the root, then hand back the slabs at once
 		// this over deleting and allocating root again, to not invalidate iterators poiting to end
-		copy.child = _root->child;
-		_root->child = nullptr;
+		destroy_children(false);
+		_arena.release();
 	}
 
 	std::pair<iterator, bool> insert(const value_type& value) {
 		node_type* target = try_insert(value.first);
 		bool has_value = target->value.has_value();
 		if (!has_value)
-			target->value.emplace(value);
-		return std::make_pair(std::move(iterator(target)), !has_value);
+			store_value(target, value);
+		return std::make_pair(wrap<iterator>(target), !has_value);
 	}
 
 	template<typename P,
@@ -233,20 +356,110 @@ public:
 		node_type* target = try_insert(value.first);
 		bool has_value = target->value.has_value();
 		if (!has_value)
-			target->value.emplace(std::move(value));
-		return std::make_pair(std::move(iterator(target)), !has_value);
+			store_value(target, std::move(value));
+		return std::make_pair(wrap<iterator>(target), !has_value);
 	}
 
+	// sorted input is appended along the rightmost path without descending from the root,
+	// elements out of order are inserted like by emplace
 	template<typename InputIt>
 	void insert(InputIt first, InputIt last) {
+		std::vector<node_type*, Alloc<node_type*>> path;
 		for (InputIt it = first; it != last; ++it) {
-			emplace(*it);
+			append(path, *it);
 		}
 	}
 
 	void insert(std::initializer_list<value_type> init) {
-		for (const value_type& val : init) {
-			emplace(val);
+		insert(init.begin(), init.end());
+	}
+
+	// range insertion spread over threads, 0 takes one per core
+	// elements are partitioned by their first fragment and every thread builds the subtries of a share of the partitions
+	// in a trie of its own, which are then linked under the root, existing subtries are moved into the threads building on them
+	// only the partitions' sizes are stored, every thread picks the elements of its share out of the range
+	// elements with equal keys keep the first one like insert, input iterators fall back to insert
+	template<typename InputIt>
+	void parallel_insert(InputIt first, InputIt last, std::size_t threads = 0) {
+		if constexpr (!std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>) {
+			insert(first, last);
+		}
+		else {
+			if (threads == 0)
+				threads = std::max(1u, std::thread::hardware_concurrency());
+			if (threads == 1) {
+				insert(first, last);
+				return;
+			}
+			// the number of elements per first fragment, in comparator order
+			std::map<K, std::size_t, key_compare> partitions(_comp);
+			std::size_t total = 0;
+			for (InputIt it = first; it != last; ++it, ++total) {
+				const key_type& key = (*it).first;
+				if (key.empty())
+					throw std::invalid_argument("key must be of positive size");
+				++partitions[key[0]];
+			}
+			if (partitions.size() < 2) {
+				insert(first, last);
+				return;
+			}
+
+			// consecutive partitions of about the same number of elements per thread, the first and last fragment of each share
+			std::vector<trie> builders;
+			std::vector<std::pair<K, K>> shares;
+			std::size_t share = 0;
+			for (const auto& [fragment, count] : partitions) {
+				if (builders.empty() || (share >= total / threads && builders.size() < threads)) {
+					builders.emplace_back(_concat, _comp);
+					shares.emplace_back(fragment, fragment);
+					share = 0;
+				}
+				if (node_type* existing = _root->find_child(fragment, _comp))
+					move_child(_root, existing, builders.back()._root);
+				shares.back().second = fragment;
+				share += count;
+			}
+
+			std::vector<std::exception_ptr> errors(builders.size());
+			auto build = [&](std::size_t i) {
+				try {
+					std::vector<node_type*, Alloc<node_type*>> path;
+					const auto& [low, high] = shares[i];
+					for (InputIt it = first; it != last; ++it) {
+						auto&& elem = *it;
+						const K& fragment = elem.first[0];
+						if (!_comp(fragment, low) && !_comp(high, fragment))
+							builders[i].append(path, std::forward<decltype(elem)>(elem));
+					}
+				}
+				catch (...) {
+					errors[i] = std::current_exception();
+				}
+			};
+			std::vector<std::thread> workers;
+			try {
+				for (std::size_t i = 1; i < builders.size(); ++i)
+					workers.emplace_back(build, i);
+			}
+			catch (...) {
+				errors[0] = std::current_exception();
+			}
+			if (!errors[0])
+				build(0);
+			// shares of threads that couldn't be started are left out, errors[0] holds why
+			for (std::thread& worker : workers)
+				worker.join();
+
+			// the subtries built and the ones moved out are linked back even if a thread failed
+			for (trie& builder : builders) {
+				while (builder._root->child)
+					move_child(builder._root, builder._root->child, _root);
+				_arena.adopt(builder._arena);
+			}
+			for (const std::exception_ptr& error : errors)
+				if (error)
+					std::rethrow_exception(error);
 		}
 	}
 
@@ -255,8 +468,11 @@ public:
 	std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj) {
 		node_type* target = try_insert(key);
 		bool has_value = target->value.has_value();
-		target->value.emplace(value_type(key, std::forward<M>(obj)));
-		return std::make_pair(std::move(iterator(target)), !has_value);
+		if (has_value)
+			mapped(target) = std::forward<M>(obj);
+		else
+			construct_value(target, key, std::forward<M>(obj));
+		return std::make_pair(wrap<iterator>(target), !has_value);
 	}
 
 	template<typename M,
@@ -264,8 +480,11 @@ public:
 	std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& obj) {
 		node_type* target = try_insert(key);
 		bool has_value = target->value.has_value();
-		target->value.emplace(value_type(std::move(key), std::forward<M>(obj)));
-		return std::make_pair(std::move(iterator(target)), !has_value);
+		if (has_value)
+			mapped(target) = std::forward<M>(obj);
+		else
+			construct_value(target, std::move(key), std::forward<M>(obj));
+		return std::make_pair(wrap<iterator>(target), !has_value);
 	}
 
 	template<typename... Args>
@@ -274,41 +493,64 @@ public:
 		node_type* target = try_insert(value.first);
 		bool has_value = target->value.has_value();
 		if (!has_value)
-			target->value.emplace(std::move(value));
-		return std::make_pair(std::move(iterator(target)), !has_value);
+			store_value(target, std::move(value));
+		return std::make_pair(wrap<iterator>(target), !has_value);
 	}
 
 	template<typename... Args>
 	std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
 		node_type* target = try_insert(key);
 		bool has_value = target->value.has_value();
-		if (!has_value) {
-			value_type value(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
-			target->value.emplace(std::move(value));
-		}
-		return std::make_pair(std::move(iterator(target)), !has_value);
+		if (!has_value)
+			construct_value(target, key, std::forward<Args>(args)...);
+		return std::make_pair(wrap<iterator>(target), !has_value);
 	}
 
 	template<typename... Args>
 	std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
 		node_type* target = try_insert(key);
 		bool has_value = target->value.has_value();
-		if (!has_value) {
-			value_type value(std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<Args>(args)...));
-			target->value.emplace(std::move(value));
-		}
-		return std::make_pair(std::move(iterator(target)), !has_value);
+		if (!has_value)
+			construct_value(target, std::move(key), std::forward<Args>(args)...);
+		return std::make_pair(wrap<iterator>(target), !has_value);
+	}
+
+	// hinted insertion, the descent starts from the deepest node hint and the key have in common instead of the root,
+	// climbing up from hint along parents, which costs the fragments below that node instead of the whole key
+	// keys inserted next to the previous one, or in order with end() as hint, save the sibling lists on the way down
+	iterator insert(const_iterator hint, const value_type& value) {
+		node_type* target = try_insert_hint(hint, value.first);
+		if (!target->value.has_value())
+			store_value(target, value);
+		return wrap<iterator>(target);
+	}
+
+	iterator insert(const_iterator hint, value_type&& value) {
+		node_type* target = try_insert_hint(hint, value.first);
+		if (!target->value.has_value())
+			store_value(target, std::move(value));
+		return wrap<iterator>(target);
+	}
+
+	template<typename P,
+		std::enable_if_t<std::is_constructible<value_type, P&&>::value, bool> = true>
+	iterator insert(const_iterator hint, P&& value) {
+		return emplace_hint(hint, std::forward<P>(value));
+	}
+
+	template<typename... Args>
+	iterator emplace_hint(const_iterator hint, Args&&... args) {
+		value_type value(std::forward<Args>(args)...);
+		node_type* target = try_insert_hint(hint, value.first);
+		if (!target->value.has_value())
+			store_value(target, std::move(value));
+		return wrap<iterator>(target);
 	}
 
 	iterator erase(iterator pos) {
 		node_type* node = get_node(pos);
 		++pos;
-		// if node has a subtree, only remove the value
-		if (node->child)
-			node->value.reset();
-		// else remove the node and all now obsolete nodes
-		else
-			node->remove_branch();
+		erase_node(node);
 		return pos;
 	}
 
@@ -316,30 +558,169 @@ public:
 		while (first != last) {
 			node_type* node = get_node(first);
 			++first;
-			if (node->child)
-				node->value.reset();
-			else
-				node->remove_branch();
+			erase_node(node);
 		}
-		return iterator(get_node(first));
+		return wrap<iterator>(get_node(first));
 	}
 
 	size_type erase(const key_type& key) {
 		const std::pair<node_type*, bool>& result = try_find(key);
 		if (result.second && result.first->value.has_value()) {
-			if (result.first->child)
-				result.first->value.reset();
-			else
-				result.first->remove_branch();
+			erase_node(result.first);
 			return 1;
 		}
 		return 0;
 	}
 
+	// erases every element whose key starts with prefix, returns the number of erased elements
+	// the subtree below the prefix is unlinked as a whole, an empty prefix clears the trie
+	size_type erase_prefix(const key_type& prefix) {
+		node_type* node = find_prefix(prefix);
+		if (node == nullptr)
+			return 0;
+		size_type count = node->weight;
+		if (node == _root) {
+			clear();
+			return count;
+		}
+		node->add_weight(-static_cast<difference_type>(count));
+		node_type* branch = node->remove_branch(_comp);
+		node_type* parent = branch->parent;
+		destroy_subtree(branch, true);
+		compress(parent);
+		return count;
+	}
+
+	// moves the elements of source whose key isn't in the trie over, like std::map::merge
+	// subtrees of source branching off where the trie has no node are relinked as a whole,
+	// only paths present in both tries are walked, so the cost follows the nodes of those paths and the nodes moved
+	// nodes keep their memory, the trie shares the slabs holding the nodes moved over to keep them alive after source is gone
+	// a node of source with a value whose key is an inner node of the trie without one takes that node's place,
+	// so no element is moved or copied and iterators to the relinked elements now point into the trie
+	void merge(trie& source) {
+		if (&source == this || source.empty())
+			return;
+
+		// pairs of nodes standing for the same path, the second of a pair is cleaned up once its children are done
+		std::vector<std::pair<std::pair<node_type*, node_type*>, bool>> stack;
+		stack.push_back({ { _root, source._root }, false });
+		std::size_t moved = 0;
+		while (!stack.empty()) {
+			auto [pair, done] = stack.back();
+			auto [to, from] = pair;
+			stack.pop_back();
+			if (done) {
+				if (from == source._root)
+					continue;
+				// the node of source is left without a value and children if everything below it moved
+				if (!from->value.has_value() && !from->child) {
+					from->parent->unlink_child(from, _comp);
+					source._arena.destroy(from);
+				}
+				else
+					source.compress(from);
+				compress(to);
+				continue;
+			}
+
+			stack.push_back({ pair, true });
+			for (node_type* node = from->child; node != nullptr;) {
+				node_type* next = node->next;
+				node_type* target = to->find_child(node->key, _comp);
+				if (target == nullptr) {
+					moved += count_nodes(node, [&](node_type* n) { _arena.share(source._arena, n); });
+					move_child(from, node, to);
+					node = next;
+					continue;
+				}
+				// both paths go on with the common fragments, the rest is split off into a child
+				if constexpr (node_type::compressed) {
+					std::size_t matched = 1;
+					while (matched < node->length() && matched < target->length() && equivalent(node->fragment(matched), target->fragment(matched)))
+						++matched;
+					if (matched < target->length())
+						target = target->split(_arena.create(target->key), matched, _comp);
+					if (matched < node->length())
+						node = node->split(source._arena.create(node->key), matched, _comp);
+				}
+				if (node->value.has_value() && !target->value.has_value()) {
+					// the node with its value takes the place of target, a stand-in takes over its children in source
+					_arena.share(source._arena, node);
+					node_type* stand_in = node->child ? source._arena.create(node->key) : nullptr;
+					if (stand_in) {
+						if constexpr (node_type::compressed)
+							stand_in->tail.swap(node->tail);
+						node->exchange(stand_in, _comp);
+						stand_in->add_weight(-1);
+					}
+					else {
+						from->unlink_child(node, _comp);
+						from->add_weight(-1);
+					}
+					node->key = target->key;
+					if constexpr (node_type::compressed)
+						node->tail.swap(target->tail);
+					target->exchange(node, _comp);
+					_arena.destroy(target);
+					node->add_weight(1);
+					++moved;
+					target = node;
+					node = stand_in;
+					if (!node) {
+						node = next;
+						continue;
+					}
+				}
+				stack.push_back({ { target, node }, false });
+				node = next;
+			}
+		}
+		_arena.take_over(source._arena, moved);
+	}
+
+	void merge(trie&& source) {
+		merge(source);
+	}
+
+	// unlinks the element at pos into a node handle, the element itself stays where it is
+	// a node without a value takes its place if it has children, otherwise the branch only leading to it is removed
+	// the element's slot isn't reused until it's inserted again, dropping the handle leaves the slot unused
+	// until the trie, and any trie sharing the slab, gives the slab back
+	node_handle extract(const_iterator pos) {
+		return extract_node(get_node(pos));
+	}
+
+	node_handle extract(iterator pos) {
+		return extract_node(get_node(pos));
+	}
+
+	node_handle extract(const key_type& key) {
+		const std::pair<node_type*, bool>& result = try_find(key);
+		if (!result.second)
+			return node_handle();
+		return extract_node(result.first);
+	}
+
+	// links the element of handle into the trie under handle.key(), unless the key is there already,
+	// in which case the handle is given back, an empty handle inserts nothing
+	insert_return_type insert(node_handle&& handle) {
+		return insert_handle(handle, [this](const key_type& key) { return try_insert(key); });
+	}
+
+	// like insert(handle), the key is looked up from hint like by insert(hint, value)
+	// a taken key leaves the handle as it was, like std::map
+	iterator insert(const_iterator hint, node_handle&& handle) {
+		insert_return_type result = insert_handle(handle, [this, hint](const key_type& key) { return try_insert_hint(hint, key); });
+		if (!result.inserted)
+			handle = std::move(result.node);
+		return result.position;
+	}
+
 	constexpr void swap(trie& other) noexcept {
 		node_type* tmp = _root;
 		this->_root = other._root;
 		other._root = tmp;
+		_arena.swap(other._arena);
 	}
 
 	// ------------------ lookup -------------------
@@ -349,11 +730,7 @@ public:
 	}
 
 	template<typename key_t, typename comp = key_compare,
-		     typename = typename comp::is_transparent,
-		     std::enable_if_t<std::conjunction_v<
-		                      std::is_default_constructible<comp>,
-			                  std::negation<std::is_convertible<key_t, key_type>>>,
-		     bool> = true>
+		     std::enable_if_t<heterogeneous<key_t, comp>, bool> = true>
 	size_type count(const key_t& key) const {
 		return try_find<key_t, comp>(key).second ? 1 : 0;
 	}
@@ -361,38 +738,32 @@ public:
 	iterator find(const key_type& key) {
 		const std::pair<node_type*, bool>& result = try_find(key);
 		if (result.second)
-			return iterator(result.first);
+			return wrap<iterator>(result.first);
 		return end();
 	}
 
 	const_iterator find(const key_type& key) const {
 		const std::pair<node_type*, bool>& result = try_find(key);
 		if (result.second)
-			return const_iterator(result.first);
+			return wrap<const_iterator>(result.first);
 		return cend();
 	}
 
 	template<typename key_t, typename comp = key_compare,
-		     typename = typename comp::is_transparent,
-		     std::enable_if_t<std::conjunction_v<std::is_default_constructible<comp>,
-		                                         std::negation<std::is_convertible<key_t, key_type>>>,
-		     bool> = true>
+		     std::enable_if_t<heterogeneous<key_t, comp>, bool> = true>
 	iterator find(const key_t& key) {
 		const std::pair<node_type*, bool>& result = try_find<key_t, comp>(key);
 		if (result.second)
-			return iterator(result.first);
+			return wrap<iterator>(result.first);
 		return end();
 	}
 
 	template<typename key_t, typename comp = key_compare,
-		     typename = typename comp::is_transparent,
-		     std::enable_if_t<std::conjunction_v<std::is_default_constructible<comp>,
-		                                         std::negation<std::is_convertible<key_t, key_type>>>,
-		     bool> = true>
+		     std::enable_if_t<heterogeneous<key_t, comp>, bool> = true>
 	const_iterator find(const key_t& key) const {
 		const std::pair<node_type*, bool>& result = try_find<key_t, comp>(key);
 		if (result.second)
-			return const_iterator(result.first);
+			return wrap<const_iterator>(result.first);
 		return cend();
 	}
 
@@ -401,10 +772,7 @@ public:
 	}
 
 	template<typename key_t, typename comp = key_compare,
-		     typename = typename comp::is_transparent,
-		     std::enable_if_t<std::conjunction_v<std::is_default_constructible<comp>,
-		                                         std::negation<std::is_convertible<key_t, key_type>>>,
-		     bool> = true>
+		     std::enable_if_t<heterogeneous<key_t, comp>, bool> = true>
 	bool contains(const key_t& key) const {
 		return try_find<key_t, comp>(key).second;
 	}
@@ -418,107 +786,317 @@ public:
 	}
 
 	template<typename key_t, typename comp = key_compare,
-		     typename = typename comp::is_transparent,
-		     std::enable_if_t<std::conjunction_v<std::is_default_constructible<comp>,
-		                                         std::negation<std::is_convertible<key_t, key_type>>>,
-		     bool> = true>
+		     std::enable_if_t<heterogeneous<key_t, comp>, bool> = true>
 	std::pair<iterator, iterator> equal_range(const key_t& key) {
 		return std::make_pair(lower_bound<key_t, comp>(key), upper_bound<key_t, comp>(key));
 	}
 
 	template<typename key_t, typename comp = key_compare,
-		     typename = typename comp::is_transparent,
-		     std::enable_if_t<std::conjunction_v<std::is_default_constructible<comp>,
-		                                         std::negation<std::is_convertible<key_t, key_type>>>,
-		     bool> = true>
+		     std::enable_if_t<heterogeneous<key_t, comp>, bool> = true>
 	std::pair<const_iterator, const_iterator> equal_range(const key_t& key) const {
 		return std::make_pair(lower_bound<key_t, comp>(key), upper_bound<key_t, comp>(key));
 	}
 
 	iterator lower_bound(const key_type& key) {
-		const std::pair<node_type*, bool>& result = try_find(key);
-		if (result.second)
-			return iterator(result.first);
-		node_type* node = result.first;
-		return iterator(find_next(key, node));
+		return wrap<iterator>(find_bound(key, false));
 	}
 
 	const_iterator lower_bound(const key_type& key) const {
-		const std::pair<node_type*, bool>& result = try_find(key);
-		if (result.second)
-			return const_iterator(result.first);
-		node_type* node = result.first;
-		return const_iterator(find_next(key, node));
+		return wrap<const_iterator>(find_bound(key, false));
 	}
 
 	template<typename key_t, typename comp = key_compare,
-		     typename = typename comp::is_transparent,
-		     std::enable_if_t<std::conjunction_v<std::is_default_constructible<comp>,
-		                                         std::negation<std::is_convertible<key_t, key_type>>>,
-		     bool> = true>
+		     std::enable_if_t<heterogeneous<key_t, comp>, bool> = true>
 	iterator lower_bound(const key_t& key) {
-		iterator it = begin();
-		comp instance{};
-		while (get_node(it) != _root && instance(it->first, key))
-			++it;
-		return it;
+		return wrap<iterator>(find_bound<key_t, comp>(key, false));
 	}
 
 	template<typename key_t, typename comp = key_compare,
-		     typename = typename comp::is_transparent,
-		     std::enable_if_t<std::conjunction_v<std::is_default_constructible<comp>,
-		                                         std::negation<std::is_convertible<key_t, key_type>>>,
-		     bool> = true>
+		     std::enable_if_t<heterogeneous<key_t, comp>, bool> = true>
 	const_iterator lower_bound(const key_t& key) const {
-		const_iterator it = begin();
-		comp instance{};
-		while (get_node(it) != _root && instance(it->first, key))
-			++it;
-		return it;
+		return wrap<const_iterator>(find_bound<key_t, comp>(key, false));
 	}
 
 	iterator upper_bound(const key_type& key) {
-		const std::pair<node_type*, bool>& result = try_find(key);
-		if (result.second) {
-			return ++iterator(result.first);
-		}
-		node_type* node = result.first;
-		return iterator(find_next(key, node));
+		return wrap<iterator>(find_bound(key, true));
 	}
 
 	const_iterator upper_bound(const key_type& key) const {
-		const std::pair<node_type*, bool>& result = try_find(key);
-		if (result.second) {
-			return ++const_iterator(result.first);
-		}
-		node_type* node = result.first;
-		return const_iterator(find_next(key, node));
+		return wrap<const_iterator>(find_bound(key, true));
 	}
 
 	template<typename key_t, typename comp = key_compare,
-		     typename = typename comp::is_transparent,
-		     std::enable_if_t<std::conjunction_v<std::is_default_constructible<comp>,
-		                                         std::negation<std::is_convertible<key_t, key_type>>>,
-		     bool> = true>
+		     std::enable_if_t<heterogeneous<key_t, comp>, bool> = true>
 	iterator upper_bound(const key_t& key) {
-		iterator it = begin();
-		comp instance{};
-		while (get_node(it) != _root && !instance(key, it->first))
-			++it;
-		return it;
+		return wrap<iterator>(find_bound<key_t, comp>(key, true));
 	}
 
 	template<typename key_t, typename comp = key_compare,
-		     typename = typename comp::is_transparent,
-		     std::enable_if_t<std::conjunction_v<std::is_default_constructible<comp>,
-		                                         std::negation<std::is_convertible<key_t, key_type>>>,
-		     bool> = true>
+		     std::enable_if_t<heterogeneous<key_t, comp>, bool> = true>
 	const_iterator upper_bound(const key_t& key) const {
-		const_iterator it = begin();
-		comp instance{};
-		while (get_node(it) != _root && !instance(key, it->first))
-			++it;
-		return it;
+		return wrap<const_iterator>(find_bound<key_t, comp>(key, true));
+	}
+
+	// -------------- batched lookup ---------------
+
+	// writes an iterator for each key of keys to out, end() for the missing ones
+	// lookups advance in groups, one node per key at a time, prefetching the next node of each
+	// so the cache misses of the group overlap instead of stalling one after the other
+	template<typename Keys, typename OutputIt>
+	OutputIt find_many(const Keys& keys, OutputIt out) {
+		find_batch(keys, [&](node_type* node) {
+			*out = node ? wrap<iterator>(node) : end();
+			++out;
+		});
+		return out;
+	}
+
+	template<typename Keys, typename OutputIt>
+	OutputIt find_many(const Keys& keys, OutputIt out) const {
+		find_batch(keys, [&](node_type* node) {
+			*out = node ? wrap<const_iterator>(node) : cend();
+			++out;
+		});
+		return out;
+	}
+
+	// writes whether the trie contains it for each key of keys to out
+	template<typename Keys, typename OutputIt>
+	OutputIt contains_many(const Keys& keys, OutputIt out) const {
+		find_batch(keys, [&](node_type* node) {
+			*out = node != nullptr;
+			++out;
+		});
+		return out;
+	}
+
+	// ----------------- prefixes ------------------
+
+	// range of the elements whose key starts with prefix,
+	// an empty range at the position of lower_bound(prefix) if there's none
+	std::pair<iterator, iterator> prefix_range(const key_type& prefix) {
+		std::pair<node_type*, node_type*> range = find_prefix_range(prefix);
+		return std::make_pair(wrap<iterator>(range.first), wrap<iterator>(range.second));
+	}
+
+	std::pair<const_iterator, const_iterator> prefix_range(const key_type& prefix) const {
+		std::pair<node_type*, node_type*> range = find_prefix_range(prefix);
+		return std::make_pair(wrap<const_iterator>(range.first), wrap<const_iterator>(range.second));
+	}
+
+	// number of elements whose key starts with prefix
+	size_type count_prefix(const key_type& prefix) const {
+		node_type* node = find_prefix(prefix);
+		return node ? node->weight : 0;
+	}
+
+	// element with the longest key that is a prefix of key, key itself included, end() if there's none
+	// the elements passed on a single descent along key are the candidates, the last one wins
+	iterator longest_prefix_match(const key_type& key) {
+		node_type* node = find_longest_prefix(key.begin(), key.end());
+		return node ? wrap<iterator>(node) : end();
+	}
+
+	const_iterator longest_prefix_match(const key_type& key) const {
+		node_type* node = find_longest_prefix(key.begin(), key.end());
+		return node ? wrap<const_iterator>(node) : cend();
+	}
+
+	template<typename key_t,
+	         std::enable_if_t<_Fragment_range<key_t, K> && !std::is_convertible_v<key_t, key_type>, bool> = true>
+	iterator longest_prefix_match(const key_t& key) {
+		node_type* node = find_longest_prefix(std::ranges::begin(key), std::ranges::end(key));
+		return node ? wrap<iterator>(node) : end();
+	}
+
+	template<typename key_t,
+	         std::enable_if_t<_Fragment_range<key_t, K> && !std::is_convertible_v<key_t, key_type>, bool> = true>
+	const_iterator longest_prefix_match(const key_t& key) const {
+		node_type* node = find_longest_prefix(std::ranges::begin(key), std::ranges::end(key));
+		return node ? wrap<const_iterator>(node) : cend();
+	}
+
+	// writes an iterator to every element whose key is a prefix of key to out, shortest first, in one descent along key
+	template<typename OutputIt>
+	OutputIt all_prefixes_of(const key_type& key, OutputIt out) {
+		for_each_prefix(key.begin(), key.end(), [&](node_type* node) {
+			*out = wrap<iterator>(node);
+			++out;
+		});
+		return out;
+	}
+
+	template<typename OutputIt>
+	OutputIt all_prefixes_of(const key_type& key, OutputIt out) const {
+		for_each_prefix(key.begin(), key.end(), [&](node_type* node) {
+			*out = wrap<const_iterator>(node);
+			++out;
+		});
+		return out;
+	}
+
+	template<typename key_t, typename OutputIt,
+	         std::enable_if_t<_Fragment_range<key_t, K> && !std::is_convertible_v<key_t, key_type>, bool> = true>
+	OutputIt all_prefixes_of(const key_t& key, OutputIt out) {
+		for_each_prefix(std::ranges::begin(key), std::ranges::end(key), [&](node_type* node) {
+			*out = wrap<iterator>(node);
+			++out;
+		});
+		return out;
+	}
+
+	template<typename key_t, typename OutputIt,
+	         std::enable_if_t<_Fragment_range<key_t, K> && !std::is_convertible_v<key_t, key_type>, bool> = true>
+	OutputIt all_prefixes_of(const key_t& key, OutputIt out) const {
+		for_each_prefix(std::ranges::begin(key), std::ranges::end(key), [&](node_type* node) {
+			*out = wrap<const_iterator>(node);
+			++out;
+		});
+		return out;
+	}
+
+	// -------------- pattern lookup ---------------
+
+	// writes a pair of an iterator and the distance for every element within max_distance edits
+	// (insertions, deletions and substitutions of fragments) of query to out, in iteration order
+	// one row of the edit distance table is computed per fragment on the way down and shared by the subtree,
+	// subtrees whose row has no entry within max_distance are skipped, so the cost follows the visited nodes
+	template<typename OutputIt>
+	OutputIt fuzzy_search(const key_type& query, size_type max_distance, OutputIt out) {
+		fuzzy_walk(query.data(), query.size(), max_distance, [&](node_type* node, size_type distance) {
+			*out = std::make_pair(wrap<iterator>(node), distance);
+			++out;
+		});
+		return out;
+	}
+
+	template<typename OutputIt>
+	OutputIt fuzzy_search(const key_type& query, size_type max_distance, OutputIt out) const {
+		fuzzy_walk(query.data(), query.size(), max_distance, [&](node_type* node, size_type distance) {
+			*out = std::make_pair(wrap<const_iterator>(node), distance);
+			++out;
+		});
+		return out;
+	}
+
+	template<typename key_t, typename OutputIt,
+	         std::enable_if_t<_Fragment_range<key_t, K> && !std::is_convertible_v<key_t, key_type>, bool> = true>
+	OutputIt fuzzy_search(const key_t& query, size_type max_distance, OutputIt out) {
+		fuzzy_walk(std::ranges::data(query), std::ranges::size(query), max_distance, [&](node_type* node, size_type distance) {
+			*out = std::make_pair(wrap<iterator>(node), distance);
+			++out;
+		});
+		return out;
+	}
+
+	template<typename key_t, typename OutputIt,
+	         std::enable_if_t<_Fragment_range<key_t, K> && !std::is_convertible_v<key_t, key_type>, bool> = true>
+	OutputIt fuzzy_search(const key_t& query, size_type max_distance, OutputIt out) const {
+		fuzzy_walk(std::ranges::data(query), std::ranges::size(query), max_distance, [&](node_type* node, size_type distance) {
+			*out = std::make_pair(wrap<const_iterator>(node), distance);
+			++out;
+		});
+		return out;
+	}
+
+	// writes an iterator to every element whose key matches pattern as a whole to out, in iteration order
+	// the pattern's automaton is run along the trie depth first, a subtree is skipped once no fragment sequence
+	// can lead to a match from the state reached, and a state taking one fragment only looks up that child
+	template<typename OutputIt>
+	OutputIt match(const pattern_type& pattern, OutputIt out) {
+		pattern_walk(pattern, [&](node_type* node) {
+			*out = wrap<iterator>(node);
+			++out;
+		});
+		return out;
+	}
+
+	template<typename OutputIt>
+	OutputIt match(const pattern_type& pattern, OutputIt out) const {
+		pattern_walk(pattern, [&](node_type* node) {
+			*out = wrap<const_iterator>(node);
+			++out;
+		});
+		return out;
+	}
+
+	// ------------- order statistics --------------
+
+	// number of elements less than key, the position lower_bound(key) would return
+	size_type rank(const key_type& key) const {
+		return position(find_bound(key, false));
+	}
+
+	// returns the element at position n in iteration order, end() if n is not less than size()
+	iterator select(size_type n) {
+		return wrap<iterator>(find_position(n));
+	}
+
+	const_iterator select(size_type n) const {
+		return wrap<const_iterator>(find_position(n));
+	}
+
+	// number of elements in [lo, hi)
+	size_type count_between(const key_type& lo, const key_type& hi) const {
+		size_type first = rank(lo);
+		size_type last = rank(hi);
+		return last > first ? last - first : 0;
+	}
+
+	// ------------- parallel traversal ------------
+	// subtrees are split into tasks and balanced over up to threads threads by work stealing, all hardware threads if 0
+	// the trie must not be changed meanwhile, the first exception thrown by a callback is rethrown once the threads finished
+
+	// calls f with every element in no particular order, f must be safe to call concurrently
+	template<typename F>
+	void parallel_for_each(F f, std::size_t threads = 0) {
+		parallel_visit(_root, threads, [&](std::size_t, node_type* node) { f(*wrap<iterator>(node)); });
+	}
+
+	template<typename F>
+	void parallel_for_each(F f, std::size_t threads = 0) const {
+		parallel_visit(_root, threads, [&](std::size_t, node_type* node) { f(*wrap<const_iterator>(node)); });
+	}
+
+	// calls f with every element whose key starts with prefix
+	template<typename F>
+	void parallel_for_each(const key_type& prefix, F f, std::size_t threads = 0) {
+		if (node_type* node = find_prefix(prefix))
+			parallel_visit(node, threads, [&](std::size_t, node_type* node) { f(*wrap<iterator>(node)); });
+	}
+
+	template<typename F>
+	void parallel_for_each(const key_type& prefix, F f, std::size_t threads = 0) const {
+		if (node_type* node = find_prefix(prefix))
+			parallel_visit(node, threads, [&](std::size_t, node_type* node) { f(*wrap<const_iterator>(node)); });
+	}
+
+	// folds transform of every element into init with reduce, which must be associative and commutative
+	// every thread folds its own partial result, those are folded into init at the end
+	template<typename T, typename Reduce, typename Transform,
+	         typename = std::enable_if_t<std::is_invocable_v<Transform&, const_reference>>>
+	T parallel_reduce(T init, Reduce reduce, Transform transform, std::size_t threads = 0) const {
+		return reduce_subtree(_root, std::move(init), reduce, transform, threads);
+	}
+
+	// folds only the elements whose key starts with prefix
+	template<typename T, typename Reduce, typename Transform,
+	         typename = std::enable_if_t<std::is_invocable_v<Transform&, const_reference>>>
+	T parallel_reduce(const key_type& prefix, T init, Reduce reduce, Transform transform, std::size_t threads = 0) const {
+		node_type* node = find_prefix(prefix);
+		return node ? reduce_subtree(node, std::move(init), reduce, transform, threads) : init;
+	}
+
+	// ------------------ snapshot -----------------
+
+	// read-only copy of the elements in a compact succinct layout, later changes to the trie don't show in it
+	frozen_trie<K, V, Concat_expr_t, Comp, Seq, Traits, Alloc> freeze() const {
+		return frozen_trie<K, V, Concat_expr_t, Comp, Seq, Traits, Alloc>(_root, [](const node_type* node) -> const V& {
+			if constexpr (implicit)
+				return *(node->value);
+			else
+				return node->value->second;
+		}, _concat, _comp);
 	}
 
 	// ----------------- observers -----------------
@@ -530,7 +1108,7 @@ public:
 	// ----------------- nonmember -----------------
 
 	friend bool operator==(const trie& lhs, const trie& rhs) {
-		return !(lhs < rhs) && !(rhs < lhs);
+		return lhs.size() == rhs.size() && !(lhs < rhs) && !(rhs < lhs);
 	}
 
 	friend bool operator!=(const trie& lhs, const trie& rhs) {
@@ -562,143 +1140,899 @@ private:
 	// function to find the node of the given key,
 	// creating the intermediate nodes in the process, if neccessary
 	node_type* try_insert(const key_type& key) {
+		return try_insert(key, _root, 0);
+	}
+
+	// descends from current, whose path is the first depth fragments of key
+	node_type* try_insert(const key_type& key, node_type* current, std::size_t depth) {
 		if (key.size() == 0)
 			throw std::invalid_argument("key must be of positive size");
-		node_type* current = _root;
-		// note that shortly after every new there's a continue for early "return"
-		for (const K& fragment : key) {
-			// action 1: insert fragment as new child
-			// occurs when current has no child
-			if (current->child == nullptr) {
-				current->set_child(new node_type(fragment));
-				current = current->child;
+		auto it = key.begin() + depth;
+		while (it != key.end()) {
+			node_type* next = current->lower_child(*it, _comp);
+			// insert the rest of the key in front of the first greater child
+			// a compressed node takes every remaining fragment, otherwise just one
+			if (next == nullptr || _comp(*it, next->key)) {
+				node_type* inserted = _arena.create(*it);
+				++it;
+				if constexpr (node_type::compressed) {
+					inserted->tail.assign(it, key.end());
+					it = key.end();
+				}
+				current->insert_child(inserted, next, _comp);
+				current = inserted;
 				continue;
 			}
 
-			current = current->child;
+			// descend, matching the rest of the node's fragments
+			++it;
+			std::size_t matched = 1;
+			while (matched < next->length() && it != key.end() && equivalent(*it, next->fragment(matched))) {
+				++matched;
+				++it;
+			}
+			// key ends or branches off inside the node
+			if constexpr (node_type::compressed) {
+				if (matched < next->length())
+					next = next->split(_arena.create(next->key), matched, _comp);
+			}
+			current = next;
+		}
+		return current;
+	}
 
-			// first handle cases around first child
-			if (!_comp(current->key, fragment)) {
-				// first child has same key as fragment
-				if (!_comp(fragment, current->key))
-					continue;
-				// first child has bigger key than fragment
-				current->set_prev(new node_type(fragment));
-				current = current->prev;
+	// links the node of handle in place of the node find returns for its key, see insert(handle)
+	template<typename Find>
+	insert_return_type insert_handle(node_handle& handle, Find&& find) {
+		if (handle.empty())
+			return insert_return_type{ end(), false, node_handle() };
+		_arena.attach(handle.slab);
+		node_type* target;
+		try {
+			target = find(handle.key());
+		}
+		catch (...) {
+			_arena.lease(handle.node);
+			throw;
+		}
+		if (target->value.has_value()) {
+			_arena.lease(handle.node);
+			return insert_return_type{ wrap<iterator>(target), false, std::move(handle) };
+		}
+		// the node takes the place of the one found for the key
+		node_type* node = std::exchange(handle.node, nullptr);
+		handle.slab.reset();
+		if constexpr (!implicit) {
+			// the const key of the pair can't be assigned to, it's replaced by a new object in its storage,
+			// which references to the pair then refer to, the mapped value stays in place
+			static_assert(std::is_nothrow_move_constructible_v<key_type>, "the key is moved into a destroyed key's storage");
+			key_type* stored = const_cast<key_type*>(std::addressof(node->value->first));
+			std::destroy_at(stored);
+			std::construct_at(stored, std::move(handle.held));
+		}
+		node->key = target->key;
+		if constexpr (node_type::compressed)
+			node->tail.swap(target->tail);
+		target->exchange(node, _comp);
+		_arena.destroy(target);
+		node->add_weight(1);
+		return insert_return_type{ wrap<iterator>(node), true, node_handle() };
+	}
+
+	// unlinks the node's value into a node handle, see extract
+	node_handle extract_node(node_type* node) {
+		key_type held;
+		if constexpr (implicit)
+			held = (*wrap<const_iterator>(node)).first;
+		else
+			held = node->value->first;
+		node_type* stand_in = node->child ? _arena.create(node->key) : nullptr;
+		node->add_weight(-1);
+		if (stand_in) {
+			if constexpr (node_type::compressed)
+				stand_in->tail.swap(node->tail);
+			node->exchange(stand_in, _comp);
+			compress(stand_in);
+		}
+		else {
+			// the branch is cut at the node's parent, so the node isn't destroyed with it
+			node_type* parent = node->parent;
+			parent->unlink_child(node, _comp);
+			if (!parent->value.has_value() && !parent->child && parent != _root) {
+				node_type* branch = parent->remove_branch(_comp);
+				node_type* top = branch->parent;
+				destroy_subtree(branch, true);
+				compress(top);
+			}
+			else
+				compress(parent);
+			node->parent = nullptr;
+		}
+		if constexpr (node_type::compressed)
+			node->tail.clear();
+		node->weight = 1;
+		return node_handle(node, _arena.lease(node), std::move(held));
+	}
+
+	// finds the node of key like try_insert, starting from the deepest node on the path of hint whose path is a prefix of key
+	// climbing up from hint only follows parents, so keys next to hint skip the sibling lists above their common node
+	// the end hint stands for the last element, which keys appended in order are next to
+	node_type* try_insert_hint(const_iterator hint, const key_type& key) {
+		if (key.size() == 0)
+			throw std::invalid_argument("key must be of positive size");
+		node_type* node = get_node(hint);
+		if (node == _root) {
+			while (node->child)
+				node = node->last_child();
+		}
+		if constexpr (!implicit) {
+			// the hint's key tells the common length, so only the nodes below it are climbed
+			if (node != _root) {
+				const key_type& hinted = node->value->first;
+				std::size_t common = 0;
+				while (common < hinted.size() && common < key.size() && equivalent(hinted[common], key[common]))
+					++common;
+				std::size_t depth = hinted.size();
+				while (depth > common) {
+					depth -= node->length();
+					node = node->parent;
+				}
+				return try_insert(key, node, depth);
+			}
+		}
+		std::size_t depth = 0;
+		for (node_type* n = node; n != _root; n = n->parent)
+			depth += n->length();
+
+		// without stored keys the whole path is compared, a node whose fragments differ from key's drops the common node to its parent
+		node_type* common = node;
+		std::size_t common_depth = depth;
+		for (node_type* n = node; n != _root; n = n->parent) {
+			std::size_t start = depth - n->length();
+			bool matches = depth <= key.size();
+			for (std::size_t i = 0; matches && i < n->length(); ++i)
+				matches = equivalent(key[start + i], n->fragment(i));
+			if (!matches) {
+				common = n->parent;
+				common_depth = start;
+			}
+			depth = start;
+		}
+		return try_insert(key, common, common_depth);
+	}
+
+	// unlinks child from its parent from and links it with its subtree under to
+	void move_child(node_type* from, node_type* child, node_type* to) {
+		std::ptrdiff_t weight = static_cast<std::ptrdiff_t>(child->weight);
+		from->unlink_child(child, _comp);
+		from->add_weight(-weight);
+		to->insert_child(child, to->lower_child(child->key, _comp), _comp);
+		to->add_weight(weight);
+	}
+
+	// calls visit(thread, node) for every node with a value in top's subtree, on up to threads threads
+	// a subtree holding more than a grain of values is a task spawning its children, smaller ones are walked in one go,
+	// so there are about eight tasks per thread to balance with, and small tries don't start threads at all
+	template<typename Visit>
+	void parallel_visit(node_type* top, std::size_t threads, Visit visit) const {
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		std::size_t grain = std::max<std::size_t>(top->weight / (threads * 8), 64);
+		if (top->weight <= grain)
+			threads = 1;
+		_Work_stealing<node_type*>::run(threads, top, [&](std::size_t thread, node_type* node, auto& spawn) {
+			if (node->weight <= grain) {
+				walk_subtree(node, [&](node_type* found) { visit(thread, found); });
+				return;
+			}
+			if (node->value.has_value())
+				visit(thread, node);
+			for (node_type* child = node->child; child != nullptr; child = child->next)
+				spawn(child);
+		});
+	}
+
+	// number of nodes in top's subtree, top included, visit is called with each of them
+	template<typename Visit>
+	static std::size_t count_nodes(node_type* top, Visit visit) {
+		std::size_t count = 0;
+		node_type* node = top;
+		while (true) {
+			visit(node);
+			++count;
+			if (node->child) {
+				node = node->child;
 				continue;
 			}
+			while (node != top && node->next == nullptr)
+				node = node->parent;
+			if (node == top)
+				return count;
+			node = node->next;
+		}
+	}
 
-			// traverse nodes and stop on the last with a smaller key than fragment
-			while (current->next && _comp(current->next->key, fragment))
-				current = current->next;
+	// calls f for every node with a value in top's subtree in iteration order
+	template<typename F>
+	static void walk_subtree(node_type* top, F&& f) {
+		node_type* node = top;
+		while (true) {
+			if (node->value.has_value())
+				f(node);
+			if (node->child) {
+				node = node->child;
+				continue;
+			}
+			while (node != top && node->next == nullptr)
+				node = node->parent;
+			if (node == top)
+				return;
+			node = node->next;
+		}
+	}
 
-			// case 2: we're at last node with key smaller than fragment
-			if (current->next == nullptr || _comp(fragment, current->next->key)) {
-				current->set_next(new node_type(fragment));
-				current = current->next;
+	template<typename T, typename Reduce, typename Transform>
+	T reduce_subtree(node_type* top, T init, Reduce& reduce, Transform& transform, std::size_t threads) const {
+		// a partial result per cache line
+		struct alignas(64) _Partial {
+			std::optional<T> value;
+		};
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<_Partial> partials(threads);
+		parallel_visit(top, threads, [&](std::size_t thread, node_type* node) {
+			std::optional<T>& partial = partials[thread].value;
+			if (partial)
+				partial = reduce(std::move(*partial), transform(*wrap<const_iterator>(node)));
+			else
+				partial.emplace(transform(*wrap<const_iterator>(node)));
+		});
+		for (_Partial& partial : partials) {
+			if (partial.value)
+				init = reduce(std::move(init), std::move(*partial.value));
+		}
+		return init;
+	}
+
+	// inserts the value of a range insertion, path caches the rightmost path of the trie from the root,
+	// keys greater than every key so far are appended at its end in O(|key|)
+	template<typename P>
+	void append(std::vector<node_type*, Alloc<node_type*>>& path, P&& elem) {
+		value_type value(std::forward<P>(elem));
+		node_type* target = try_append(path, value.first);
+		if (target == nullptr) {
+			// inserting elsewhere might split nodes of the path, it's rebuilt for the next element
+			path.clear();
+			target = try_insert(value.first);
+		}
+		if (!target->value.has_value())
+			store_value(target, std::move(value));
+	}
+
+	// returns the node of key if it's on the rightmost path or can be appended to it,
+	// nullptr if key is less than the greatest key
+	node_type* try_append(std::vector<node_type*, Alloc<node_type*>>& path, const key_type& key) {
+		if (key.size() == 0)
+			throw std::invalid_argument("key must be of positive size");
+		if (path.empty()) {
+			for (node_type* n = _root; n != nullptr; n = n->last_child())
+				path.push_back(n);
+		}
+
+		// follow the path as long as key matches it
+		auto it = key.begin();
+		std::size_t depth = 1;
+		for (; depth < path.size(); ++depth) {
+			node_type* node = path[depth];
+			std::size_t matched = 0;
+			while (matched < node->length() && it != key.end() && equivalent(*it, node->fragment(matched))) {
+				++matched;
+				++it;
+			}
+			if (matched == node->length())
 				continue;
+			// key is a prefix of the node's path or branches off to the left
+			if (it == key.end() || _comp(*it, node->fragment(matched)))
+				return nullptr;
+
+			// key branches off to the right, the rest of the path is left behind
+			path.resize(depth);
+			if constexpr (node_type::compressed) {
+				if (matched > 0)
+					path.push_back(node->split(_arena.create(node->key), matched, _comp));
 			}
+			break;
+		}
 
-			// case 3: next node has same key as fragment
-			current = current->next;
+		if (it == key.end()) {
+			// key ends at a node of the path, with a value or less than the values below it
+			node_type* node = path[depth - 1];
+			return node->value.has_value() ? node : nullptr;
 		}
-		return current;
+
+		// the rest of the key becomes the new last child, a single node for compressed layouts
+		while (it != key.end()) {
+			node_type* inserted = _arena.create(*it);
+			++it;
+			if constexpr (node_type::compressed) {
+				inserted->tail.assign(it, key.end());
+				it = key.end();
+			}
+			path.back()->insert_child(inserted, nullptr, _comp);
+			path.push_back(inserted);
+		}
+		return path.back();
 	}
 
+	// ranges of fragments are looked up like key_type, descending fragment by fragment
 	// for general keys lookup compares to the entire key, not per-fragment
 	// which requires the comparator to also provide comparison for key_type, not just K
-	template<typename key_t, typename comp,
-		     std::enable_if_t<std::is_default_constructible_v<comp>, bool> = true>
+	template<typename key_t, typename comp>
 	const std::pair<node_type*, bool> try_find(const key_t& key) const {
-		comp instance{};
-		for (const_iterator it = cbegin(); it != cend(); ++it) {
-			if (!instance(key, it->first) && !instance(it->first, key))
-				return std::make_pair(get_node(it), true);
+		if constexpr (_Fragment_range<key_t, K>)
+			return find_fragments(std::ranges::begin(key), std::ranges::end(key));
+		else {
+			comp instance{};
+			for (const_iterator it = cbegin(); it != cend(); ++it) {
+				if (!instance(key, it->first) && !instance(it->first, key))
+					return std::make_pair(get_node(it), true);
+			}
+			return std::make_pair(_root, false);
 		}
-		return std::make_pair(_root, false);
 	}
 
-	// similar to try_insert_key, but returns when creating a new node would be required
 	const std::pair<node_type*, bool> try_find(const key_type& key) const {
-		if (key.size() == 0)
+		return find_fragments(key.begin(), key.end());
+	}
+
+	// similar to try_insert, but returns when creating a new node would be required
+	template<typename It, typename End>
+	const std::pair<node_type*, bool> find_fragments(It it, End last) const {
+		if (it == last)
 			throw std::invalid_argument("key must be of positive size");
 		node_type* current = _root;
-		for (const K& fragment : key) {
-			if (current->child == nullptr)
+		while (it != last) {
+			node_type* next = current->find_child(*it, _comp);
+			if (next == nullptr)
 				return std::make_pair(current, false);
 
-			current = current->child;
-			while (current->next && _comp(current->key, fragment))
-				current = current->next;
-
-			// still need to check both _comp-s next might be nullptr
-			if (_comp(fragment, current->key) || _comp(current->key, fragment))
-				return std::make_pair(current, false);
+			++it;
+			for (std::size_t i = 1; i < next->length(); ++i, ++it) {
+				if (it == last || !equivalent(*it, next->fragment(i)))
+					return std::make_pair(next, false);
+			}
+			current = next;
 		}
 		return std::make_pair(current, current->value.has_value());
 	}
 
-	// helper function used for bounds functions
-	// the param node is presumably supplied by try_find
-	node_type* find_next(const key_type& key, node_type* node) const {
-		// early check for root
-		if (node == _root)
-			return node;
-
-		node_type* current = node;
-		// first exit point of try_find -> here key definitely is smaller
-		if (current->child == nullptr) {
-			while (current->parent != nullptr && current->next == nullptr)
-				current = current->parent;
-			if (current->next) {
-				current = current->next;
-				// no need to check if child is nullptr, because leaves always contain a value
-				while (!current->value.has_value())
-					current = current->child;
-			}
-			// this might return _root
-			return current;
-		}
-		// second exit point, current can be either greater or less
-		// if next is not nullptr, current node is always greater
-		if (current->next != nullptr) {
-			while (!current->value.has_value())
-				current = current->child;
-			return current;
-		}
-		
-		// find out if the key was smaller or greater
-		// first get to the mismatched char
-		auto it = key.begin();
-		node_type* temp = current;
-		// checking for temp == _root would cause one more increment than neccessary
-		// rather have it this way than requiring the iterator to be bidirectional
-		while (temp->parent != _root) {
+	// number of lookups find_batch keeps in flight
+	static constexpr std::size_t batch_size = 16;
+
+	// looks up the keys of a range in groups of batch_size, calling emit with the node of each key
+	// in order, nullptr if it's missing, keys are ranges of fragments
+	template<typename Keys, typename F>
+	void find_batch(const Keys& keys, F&& emit) const {
+		using fragment_iterator = decltype(std::begin(*std::begin(keys)));
+		// node is reached through its first fragment, the rest is matched when it's visited
+		struct lookup {
+			node_type* node;
+			fragment_iterator it;
+			fragment_iterator last;
+			bool done;
+		};
+
+		lookup group[batch_size];
+		auto first = std::begin(keys);
+		auto last = std::end(keys);
+		while (first != last) {
+			std::size_t count = 0;
+			for (; count < batch_size && first != last; ++count, ++first) {
+				group[count] = lookup{ _root, std::begin(*first), std::end(*first), false };
+				if (group[count].it == group[count].last)
+					throw std::invalid_argument("key must be of positive size");
+			}
+
+			std::size_t active = count;
+			while (active > 0) {
+				for (std::size_t i = 0; i < count; ++i) {
+					lookup& l = group[i];
+					if (l.done)
+						continue;
+					if (!visit(l.node, l.it, l.last)) {
+						l.done = true;
+						--active;
+						continue;
+					}
+					// the next node is only touched in the next round
+					_prefetch(l.node);
+				}
+			}
+			for (std::size_t i = 0; i < count; ++i)
+				emit(group[i].node);
+		}
+	}
+
+	// one step of a batched lookup, matches the rest of node's fragments and moves to the child for the next one
+	// returns false once the lookup is over, leaving node as its result
+	template<typename It>
+	bool visit(node_type*& node, It& it, const It& last) const {
+		for (std::size_t i = 1; i < node->length(); ++i, ++it) {
+			if (it == last || !equivalent(*it, node->fragment(i))) {
+				node = nullptr;
+				return false;
+			}
+		}
+		if (it == last) {
+			if (!node->value.has_value())
+				node = nullptr;
+			return false;
+		}
+		node = node->find_child(*it, _comp);
+		++it;
+		return node != nullptr;
+	}
+
+	// returns the topmost node whose path starts with prefix, nullptr if there's none
+	// in compressed layouts the prefix might end inside the returned node
+	node_type* find_prefix(const key_type& prefix) const {
+		node_type* current = _root;
+		auto it = prefix.begin();
+		while (it != prefix.end()) {
+			node_type* next = current->find_child(*it, _comp);
+			if (next == nullptr)
+				return nullptr;
+
 			++it;
-			temp = temp->parent;
-		}
-		// node's key was smaller, same as at first exit point
-		if (_comp(current->key, *it)) {
-			while (current->parent != nullptr && current->next == nullptr)
-				current = current->parent;
-			if (current->next) {
-				current = current->next;
-				while (!current->value.has_value())
-					current = current->child;
-			}
-			// this might return _root
-			return current;
-		}
-		// node's key was greater, find first value in subtree
-		// since key was not found equality can never occur
-		while (!current->value.has_value())
-			current = current->child;
+			for (std::size_t i = 1; i < next->length() && it != prefix.end(); ++i, ++it) {
+				if (!equivalent(*it, next->fragment(i)))
+					return nullptr;
+			}
+			current = next;
+		}
 		return current;
 	}
 
+	// calls f for every node with a value whose path is a prefix of the fragments from it to last, top down
+	template<typename It, typename End, typename F>
+	void for_each_prefix(It it, End last, F&& f) const {
+		node_type* current = _root;
+		while (it != last) {
+			node_type* next = current->find_child(*it, _comp);
+			if (next == nullptr)
+				return;
+			++it;
+			// a compressed node only counts if the key covers all of its fragments
+			for (std::size_t i = 1; i < next->length(); ++i, ++it) {
+				if (it == last || !equivalent(*it, next->fragment(i)))
+					return;
+			}
+			if (next->value.has_value())
+				f(next);
+			current = next;
+		}
+	}
+
+	template<typename It, typename End>
+	node_type* find_longest_prefix(It it, End last) const {
+		node_type* longest = nullptr;
+		for_each_prefix(it, last, [&](node_type* node) { longest = node; });
+		return longest;
+	}
+
+	// calls f(node, distance) for every node with a value within max_distance edits of query, in iteration order
+	// the rows of the edit distance table are kept one per fragment of the current path,
+	// siblings overwrite each other's rows below their common depth
+	template<typename F>
+	void fuzzy_walk(const K* query, std::size_t length, size_type max_distance, F&& f) const {
+		const std::size_t width = length + 1;
+		std::vector<size_type, Alloc<size_type>> rows(width * 2);
+		for (std::size_t j = 0; j < width; ++j)
+			rows[j] = j;
+
+		// the child of parent after the given one (the first if nullptr) which may still be within max_distance
+		// once no entry of the parent's row is below max_distance, a child can only keep one in reach by taking
+		// the query fragment next to it, so those are looked up instead of going through every child
+		auto next_child = [&](const node_type* parent, std::size_t depth, const node_type* after) -> node_type* {
+			const size_type* row = rows.data() + depth * width;
+			if (*std::min_element(row, row + width) < max_distance)
+				return after ? after->next : parent->child;
+			const K* bound = after ? &after->key : nullptr;
+			while (true) {
+				const K* least = nullptr;
+				for (std::size_t j = 0; j < length; ++j) {
+					if (row[j] <= max_distance && (!bound || _comp(*bound, query[j])) && (!least || _comp(query[j], *least)))
+						least = query + j;
+				}
+				if (least == nullptr)
+					return nullptr;
+				if (node_type* child = parent->find_child(*least, _comp))
+					return child;
+				bound = least;
+			}
+		};
+
+		node_type* node = next_child(_root, 0, nullptr);
+		std::size_t start = 0;	// fragments on the path above node
+		while (node) {
+			std::size_t depth = start;
+			bool near = true;
+			for (std::size_t i = 0; near && i < node->length(); ++i, ++depth) {
+				if (rows.size() < (depth + 2) * width)
+					rows.resize((depth + 2) * width);
+				const K& fragment = node->fragment(i);
+				size_type* above = rows.data() + depth * width;
+				size_type* row = above + width;
+				row[0] = above[0] + 1;
+				size_type least = row[0];
+				for (std::size_t j = 1; j < width; ++j) {
+					row[j] = std::min({ above[j] + 1, row[j - 1] + 1, above[j - 1] + !equivalent(query[j - 1], fragment) });
+					least = std::min(least, row[j]);
+				}
+				near = least <= max_distance;
+			}
+			if (near) {
+				size_type distance = rows[depth * width + width - 1];
+				if (node->value.has_value() && distance <= max_distance)
+					f(node, distance);
+				if (node_type* child = node->child ? next_child(node, depth, nullptr) : nullptr) {
+					start = depth;
+					node = child;
+					continue;
+				}
+			}
+			// the next sibling worth visiting, or the one of the closest ancestor having one
+			node_type* next;
+			while ((next = next_child(node->parent, start, node)) == nullptr) {
+				node = node->parent;
+				if (node == _root)
+					return;
+				start -= node->length();
+			}
+			node = next;
+		}
+	}
+
+	// calls f(node) for every node with a value whose key matches pattern, in iteration order
+	// the automaton states are kept one per fragment of the current path like the rows of fuzzy_walk
+	template<typename F>
+	void pattern_walk(const pattern_type& pattern, F&& f) const {
+		using automaton_type = _Pattern_automaton<K, Comp>;
+		automaton_type automaton(pattern, _comp);
+		std::vector<size_type, Alloc<size_type>> states(1, automaton.start());
+		// the child of parent after the given one (the first if nullptr) which the automaton may go on with from state,
+		// a state taking a single fragment only looks up that child instead of going through every child
+		auto next_child = [&](const node_type* parent, size_type state, const node_type* after) -> node_type* {
+			if (const K* only = automaton.only(state))
+				return after ? nullptr : parent->find_child(*only, _comp);
+			return after ? after->next : parent->child;
+		};
+
+		node_type* node = next_child(_root, states[0], nullptr);
+		std::size_t start = 0;	// fragments on the path above node
+		while (node) {
+			std::size_t depth = start;
+			size_type state = states[start];
+			for (std::size_t i = 0; state != automaton_type::dead && i < node->length(); ++i) {
+				state = automaton.next(state, node->fragment(i));
+				if (states.size() <= ++depth)
+					states.resize(depth + 1);
+				states[depth] = state;
+			}
+			if (state != automaton_type::dead) {
+				if (node->value.has_value() && automaton.accepts(state))
+					f(node);
+				if (node_type* child = node->child ? next_child(node, state, nullptr) : nullptr) {
+					start = depth;
+					node = child;
+					continue;
+				}
+			}
+			// the next sibling worth visiting, or the one of the closest ancestor having one
+			node_type* next;
+			while ((next = next_child(node->parent, states[start], node)) == nullptr) {
+				node = node->parent;
+				if (node == _root)
+					return;
+				start -= node->length();
+			}
+			node = next;
+		}
+	}
+
+	// first and past the last node with a value below the prefix
+	std::pair<node_type*, node_type*> find_prefix_range(const key_type& prefix) const {
+		node_type* node = find_prefix(prefix);
+		if (node == _root)
+			return std::make_pair(first_value_or_root(), _root);
+		if (node == nullptr) {
+			node_type* bound = find_bound(prefix, false);
+			return std::make_pair(bound, bound);
+		}
+		return std::make_pair(first_value(node), skip_subtree(node));
+	}
+
+	// bounds of heterogeneous keys, ranges of fragments descend like key_type,
+	// any other key type is compared with whole keys from the first element on
+	template<typename key_t, typename comp>
+	node_type* find_bound(const key_t& key, bool upper) const {
+		if constexpr (_Fragment_range<key_t, K>)
+			return find_bound(std::ranges::begin(key), std::ranges::end(key), upper);
+		else {
+			comp instance{};
+			const_iterator it = cbegin();
+			while (get_node(it) != _root && (upper ? !instance(key, it->first) : instance(it->first, key)))
+				++it;
+			return get_node(it);
+		}
+	}
+
+	node_type* find_bound(const key_type& key, bool upper) const {
+		return find_bound(key.begin(), key.end(), upper);
+	}
+
+	// helper function used for bounds functions, descends along the key's fragments
+	// and returns the first node with a value not less than key,
+	// or greater than it if upper is set, _root if there's none
+	template<typename It, typename End>
+	node_type* find_bound(It it, End last, bool upper) const {
+		if (it == last)
+			throw std::invalid_argument("key must be of positive size");
+		node_type* current = _root;
+		while (it != last) {
+			node_type* next = current->lower_child(*it, _comp);
+			// every child is less than key
+			if (next == nullptr)
+				return skip_subtree(current);
+			// next and the siblings after it are all greater
+			if (_comp(*it, next->key))
+				return first_value(next);
+
+			++it;
+			for (std::size_t i = 1; i < next->length(); ++i, ++it) {
+				// key is a prefix of the node's path, or branches off to the left
+				if (it == last || _comp(*it, next->fragment(i)))
+					return first_value(next);
+				// key branches off to the right
+				if (_comp(next->fragment(i), *it))
+					return skip_subtree(next);
+			}
+			current = next;
+		}
+		// key is on the path of current
+		if (current->value.has_value())
+			return upper ? skip_value(current) : current;
+		return first_value(current);
+	}
+
+	// number of values in front of node in iteration order, node has a value or is the root
+	// for each node on the path those are the parent's value and the subtrees of the previous siblings
+	size_type position(const node_type* node) const {
+		if (node == _root)
+			return _root->weight;
+		size_type n = 0;
+		for (; node != _root; node = node->parent)
+			n += node->parent->weight_before(node, _comp) + node->parent->value.has_value();
+		return n;
+	}
+
+	// node holding the value at position n in iteration order, _root if there's none
+	node_type* find_position(size_type n) const noexcept {
+		if (n >= _root->weight)
+			return _root;
+		node_type* node = _root;
+		while (true) {
+			if (node->value.has_value()) {
+				if (n == 0)
+					return node;
+				--n;
+			}
+			// the weights of the children add up to the remaining values, one of them contains position n
+			node = node->child_at_weight(n);
+		}
+	}
+
+	// first node with a value in node's subtree in iteration order
+	// no need to check if child is nullptr, because leaves always contain a value
+	static node_type* first_value(node_type* node) noexcept {
+		while (!node->value.has_value())
+			node = node->child;
+		return node;
+	}
+
+	node_type* first_value_or_root() const noexcept {
+		return _root->child ? first_value(_root->child) : _root;
+	}
+
+	// first node with a value after node's subtree in iteration order, might be the root
+	static node_type* skip_subtree(node_type* node) noexcept {
+		while (node->next == nullptr && node->parent != nullptr)
+			node = node->parent;
+		if (node->next)
+			return first_value(node->next);
+		return node;
+	}
+
+	// first node with a value after node in iteration order, might be the root
+	static node_type* skip_value(node_type* node) noexcept {
+		if (node->child)
+			return first_value(node->child);
+		return skip_subtree(node);
+	}
+
+	template<typename It>
+	constexpr It wrap(node_type* node) const noexcept {
+		return It(node);
+	}
+
+	static mapped_type& mapped(node_type* node) noexcept {
+		if constexpr (implicit)
+			return *(node->value);
+		else
+			return node->value->second;
+	}
+
+	// constructs the value of a node without one from its key and the arguments of the mapped value
+	template<typename Key, typename... Args>
+	static void construct_value(node_type* node, Key&& key, Args&&... args) {
+		if constexpr (implicit)
+			node->value.emplace(std::forward<Args>(args)...);
+		else
+			node->value.emplace(std::piecewise_construct, std::forward_as_tuple(std::forward<Key>(key)),
+			                    std::forward_as_tuple(std::forward<Args>(args)...));
+		node->add_weight(1);
+	}
+
+	template<typename P>
+	static void store_value(node_type* node, P&& value) {
+		if constexpr (implicit)
+			node->value.emplace(std::forward<P>(value).second);
+		else
+			node->value.emplace(std::forward<P>(value));
+		node->add_weight(1);
+	}
+
+	bool equivalent(const K& lhs, const K& rhs) const {
+		return !_comp(lhs, rhs) && !_comp(rhs, lhs);
+	}
+
+	// removes the value of node, along with the nodes which only existed to lead to it
+	void erase_node(node_type* node) {
+		node->add_weight(-1);
+		// if node has a subtree, only remove the value
+		if (node->child) {
+			node->value.reset();
+			compress(node);
+		}
+		// else remove the node and all now obsolete nodes
+		else {
+			node_type* branch = node->remove_branch(_comp);
+			node_type* parent = branch->parent;
+			destroy_subtree(branch, true);
+			compress(parent);
+		}
+	}
+
+	// restores the invariant of compressed layouts after node lost its value or a child
+	void compress(node_type* node) {
+		if constexpr (node_type::compressed) {
+			if (node != _root && !node->value.has_value() && node->child && !node->child->next) {
+				node->merge_into_child(_comp);
+				_arena.destroy(node);
+			}
+		}
+	}
+
+	static node_type* make_root(const key_concat& concat) {
+		Alloc<root_type> alloc;
+		root_type* root = root_traits::allocate(alloc, 1);
+		try {
+			::new (static_cast<void*>(root)) root_type(concat);
+		}
+		catch (...) {
+			root_traits::deallocate(alloc, root, 1);
+			throw;
+		}
+		return root;
+	}
+
+	static void free_root(node_type* root) noexcept {
+		Alloc<root_type> alloc;
+		root_type* owner = static_cast<root_type*>(root);
+		owner->~root_type();
+		root_traits::deallocate(alloc, owner, 1);
+	}
+
+	// empties the trie, also giving a root to a moved-from one
+	void reset() {
+		if (_root)
+			clear();
+		else
+			_root = make_root(_concat);
+	}
+
+	// deep copies the count nodes below from to below to, which has no children yet
+	// walks the source in iteration order without recursion, so the copies are laid out in that order in one slab
+	void copy_children(const node_type* from, node_type* to, size_type count) {
+		to->weight = from->weight;
+		if (from->child == nullptr)
+			return;
+		_arena.reserve(count);
+
+		const node_type* source = from->child;
+		node_type* copy = _arena.create(*source);
+		to->set_child(copy);
+		while (true) {
+			if (source->child) {
+				source = source->child;
+				node_type* created = _arena.create(*source);
+				copy->set_child(created);
+				copy = created;
+				continue;
+			}
+			// climbs back up while the source node was the last of its siblings,
+			// a node's index is built once all of its children are linked
+			while (source->next == nullptr) {
+				source = source->parent;
+				copy = copy->parent;
+				if (source->index)
+					copy->build_index(source->index->is_direct());
+				if (source == from)
+					return;
+			}
+			source = source->next;
+			node_type* created = _arena.create(*source);
+			copy->set_next(created);
+			copy = created;
+		}
+	}
+
+	// destroys top and its subtree, top has to be unlinked already
+	// walks the subtree without recursion, destroying nodes as soon as their children are gone
+	// recycled nodes go to the arena's free list, others are expected to be released with the slabs
+	void destroy_subtree(node_type* top, bool recycle) noexcept {
+		node_type* node = top;
+		while (true) {
+			while (node->child)
+				node = node->child;
+
+			// climbs back up while the destroyed node was the last of its siblings,
+			// a parent only gets here after all of its children are gone
+			while (true) {
+				node_type* next = node->next;
+				node_type* parent = node->parent;
+				bool done = node == top;
+				if (recycle)
+					_arena.destroy(node);
+				else
+					_arena.discard(node);
+				if (done)
+					return;
+				if (next) {
+					node = next;
+					break;
+				}
+				node = parent;
+			}
+		}
+	}
+
+	void destroy_children(bool recycle) noexcept {
+		node_type* node = _root->child;
+		_root->child = nullptr;
+		_root->weight = 0;
+		_root->drop_index();
+		while (node) {
+			node_type* next = node->next;
+			destroy_subtree(node, recycle);
+			node = next;
+		}
+	}
+
 	key_concat _concat;
 	node_type* _root;
 	const key_compare _comp;
+	arena_type _arena;
 
 }; // class trie
 
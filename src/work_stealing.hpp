@@ -0,0 +1,114 @@
+#pragma once
+
+#ifndef LTR_WORK_STEALING
+#define LTR_WORK_STEALING
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ltr {
+
+// runs tasks which may spawn more tasks on a number of threads until none are left
+// every thread works its own queue last in first out, keeping to the subtree it split last,
+// and steals the oldest task of another queue once its own is empty, which is the biggest one left there
+// the first exception thrown by a task stops the other threads and is rethrown
+template<typename T>	// task type
+class _Work_stealing {
+public:
+	// work is called as work(thread, task, spawn) with spawn(task) queueing a new task
+	template<typename Work>
+	static void run(std::size_t threads, const T& initial, Work&& work) {
+		_Work_stealing pool(threads);
+		pool.queues[0].tasks.push_back(initial);
+		pool.pending = 1;
+
+		std::vector<std::thread> workers;
+		try {
+			for (std::size_t i = 1; i < threads; ++i)
+				workers.emplace_back([&pool, &work, i] { pool.loop(i, work); });
+		}
+		catch (...) {
+			// stops the threads started so far
+			pool.fail(std::current_exception());
+		}
+		pool.loop(0, work);
+		for (std::thread& worker : workers)
+			worker.join();
+		if (pool.error)
+			std::rethrow_exception(pool.error);
+	}
+
+private:
+	struct alignas(64) _Queue {
+		std::mutex lock;
+		std::deque<T> tasks;
+	};
+
+	explicit _Work_stealing(std::size_t threads) : queues(threads), pending(0), failed(false) {}
+
+	template<typename Work>
+	void loop(std::size_t self, Work& work) {
+		auto spawn = [this, self](const T& task) {
+			pending.fetch_add(1);
+			std::lock_guard<std::mutex> guard(queues[self].lock);
+			queues[self].tasks.push_back(task);
+		};
+		T task;
+		while (pending.load() > 0 && !failed.load()) {
+			if (!take(self, task)) {
+				std::this_thread::yield();
+				continue;
+			}
+			try {
+				work(self, task, spawn);
+			}
+			catch (...) {
+				fail(std::current_exception());
+			}
+			pending.fetch_sub(1);
+		}
+	}
+
+	// the newest task of the own queue, or else the oldest of the first other queue having one
+	bool take(std::size_t self, T& task) {
+		for (std::size_t i = 0; i < queues.size(); ++i) {
+			_Queue& queue = queues[(self + i) % queues.size()];
+			std::lock_guard<std::mutex> guard(queue.lock);
+			if (queue.tasks.empty())
+				continue;
+			if (i == 0) {
+				task = queue.tasks.back();
+				queue.tasks.pop_back();
+			}
+			else {
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+			}
+			return true;
+		}
+		return false;
+	}
+
+	void fail(std::exception_ptr thrown) {
+		std::lock_guard<std::mutex> guard(error_lock);
+		if (!error)
+			error = thrown;
+		failed = true;
+	}
+
+	std::vector<_Queue> queues;
+	std::atomic<std::size_t> pending;	// tasks queued or running
+	std::atomic<bool> failed;
+	std::mutex error_lock;
+	std::exception_ptr error;
+
+}; // class _Work_stealing
+
+} // namespace ltr
+
+#endif // LTR_WORK_STEALING
@@ -1,8 +1,30 @@
 #include <cassert>
 #include <utility>
 #include <iterator>
+#include <vector>
+#include <map>
+#include <random>
+#include <string_view>
+#include <span>
+#include <array>
+#include <sstream>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <regex>
+#include <bit>
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
 
 #include "src/trie.hpp"
+#include "src/mapped_file.hpp"
+#include "src/journal.hpp"
+#include "src/concurrent_trie.hpp"
+#include "src/olc_trie.hpp"
 
 const auto& concat = [](std::string& Seq, char C)
 -> std::string& {
@@ -230,7 +252,7 @@ void TestErase() {
                        {"bcde",   72},
                        {"hgasha", 80}}, concat};
     assert(trie.size() == 6);
-    auto& eraseAbcd = ++trie.begin();
+    auto eraseAbcd = ++trie.begin();
     eraseAbcd = trie.erase(eraseAbcd);
     assert(trie.size() == 5);
     try {
@@ -397,6 +419,1373 @@ void TestNonmembers() {
     assert(other <= other);
 }
 
+// comparison matching the trie's per-fragment std::less<char> ordering,
+// std::string itself compares chars as unsigned
+struct fragment_order {
+    bool operator()(const std::string& lhs, const std::string& rhs) const {
+        return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::less<char>());
+    }
+};
+
+void TestChildIndex() {
+    default_trie trie(concat);
+    std::map<std::string, int, fragment_order> expected;
+    // grow the root through every index stage up to the direct table
+    for (int c = -128; c < 128; ++c) {
+        std::string key(1, static_cast<char>(c));
+        trie.emplace(key, c);
+        trie.emplace(key + "x", c * 2);
+        expected.emplace(key, c);
+        expected.emplace(key + "x", c * 2);
+    }
+    assert(trie.size() == expected.size());
+    assert(std::equal(trie.begin(), trie.end(), expected.begin(), expected.end()));
+    for (const auto& [key, value] : expected)
+        assert(trie.at(key) == value);
+    assert(trie.upper_bound("\x7f")->first == "\x7fx");
+    assert(trie.lower_bound("\x7f\x7f") == trie.end());
+    assert(trie.upper_bound("\x7fx") == trie.end());
+
+    // shrink back through the stages, erasing every other key
+    for (int c = -128; c < 128; c += 2) {
+        std::string key(1, static_cast<char>(c));
+        trie.erase(key);
+        trie.erase(key + "x");
+        expected.erase(key);
+        expected.erase(key + "x");
+        assert(trie.find(key) == trie.end());
+        assert(trie.contains(std::string(1, static_cast<char>(c + 1))));
+    }
+    assert(std::equal(trie.begin(), trie.end(), expected.begin(), expected.end()));
+    default_trie copy = trie;
+    assert(copy == trie);
+    while (!expected.empty()) {
+        assert(copy.erase(expected.begin()->first) == 1);
+        expected.erase(expected.begin());
+        assert(std::equal(copy.begin(), copy.end(), expected.begin(), expected.end()));
+    }
+    assert(copy.empty());
+
+    // fragments wider than a byte stay in the sorted arrays
+    const auto wconcat = [](std::wstring& Seq, wchar_t C) -> std::wstring& {
+        Seq.push_back(C);
+        return Seq;
+    };
+    ltr::trie<wchar_t, int, decltype(wconcat)> wide(wconcat);
+    for (int c = 300; c > 0; --c)
+        wide.emplace(std::wstring(1, static_cast<wchar_t>(c * 7)), c);
+    int last = 0;
+    for (const auto& [key, value] : wide) {
+        assert(value > last);
+        last = value;
+    }
+    assert(wide.size() == 300 && wide.at(std::wstring(1, 7 * 150)) == 150);
+}
+
+using compressed_trie = trie<char, int, decltype(concat), std::less, std::basic_string,
+                             std::char_traits, std::allocator, path_compression>;
+
+using implicit_trie = trie<char, int, decltype(concat), std::less, std::basic_string,
+                           std::char_traits, std::allocator, path_compression | implicit_keys>;
+
+// element-wise comparison that also works for the proxies of implicit key tries
+const auto& sameElement = [](const auto& lhs, const auto& rhs) {
+    return lhs.first == rhs.first && lhs.second == rhs.second;
+};
+
+// key of 1 to max_length fragments from 'a' to last_letter
+std::string RandomKey(std::mt19937& gen, int max_length, char last_letter) {
+    std::uniform_int_distribution<int> length(1, max_length);
+    std::uniform_int_distribution<int> letter('a', last_letter);
+    std::string key(length(gen), 'a');
+    for (char& c : key)
+        c = static_cast<char>(letter(gen));
+    return key;
+}
+
+// levenshtein distance over fragments
+std::size_t EditDistance(const std::string& lhs, const std::string& rhs) {
+    std::vector<std::size_t> row(rhs.size() + 1);
+    for (std::size_t j = 0; j <= rhs.size(); ++j)
+        row[j] = j;
+    for (std::size_t i = 1; i <= lhs.size(); ++i) {
+        std::size_t diagonal = row[0];
+        row[0] = i;
+        for (std::size_t j = 1; j <= rhs.size(); ++j)
+            diagonal = std::exchange(row[j], std::min({ row[j] + 1, row[j - 1] + 1, diagonal + (lhs[i - 1] != rhs[j - 1]) }));
+    }
+    return row[rhs.size()];
+}
+
+// random keys over a small alphabet share lots of prefixes, making nodes split and merge
+template<typename Trie>
+void CheckAgainstMap(unsigned seed) {
+    std::mt19937 gen(seed);
+
+    Trie trie(concat);
+    std::map<std::string, int, fragment_order> expected;
+    for (int i = 0; i < 400; ++i) {
+        std::string key = RandomKey(gen, 7, 'd');
+        assert(trie.emplace(key, i).second == expected.emplace(key, i).second);
+    }
+    for (int i = 0; i < 200; ++i) {
+        std::string key = RandomKey(gen, 7, 'd');
+        assert(trie.erase(key) == expected.erase(key));
+    }
+    assert(std::equal(trie.begin(), trie.end(), expected.begin(), expected.end(), sameElement));
+    assert(std::equal(trie.rbegin(), trie.rend(), expected.rbegin(), expected.rend(), sameElement));
+    for (int i = 0; i < 400; ++i) {
+        std::string key = RandomKey(gen, 7, 'd');
+        auto lower = expected.lower_bound(key);
+        auto upper = expected.upper_bound(key);
+        assert(lower == expected.end() ? trie.lower_bound(key) == trie.end() : trie.lower_bound(key)->first == lower->first);
+        assert(upper == expected.end() ? trie.upper_bound(key) == trie.end() : trie.upper_bound(key)->first == upper->first);
+        assert(trie.contains(key) == expected.contains(key));
+        assert(trie.rank(key) == static_cast<std::size_t>(std::distance(expected.begin(), lower)));
+        assert(trie.lower_bound(std::string_view(key)) == trie.lower_bound(key));
+        assert(trie.upper_bound(std::string_view(key)) == trie.upper_bound(key));
+    }
+    assert(trie.size() == expected.size());
+    auto position = expected.begin();
+    for (std::size_t i = 0; i < expected.size(); ++i, ++position)
+        assert(trie.select(i)->first == position->first);
+    assert(trie.select(expected.size()) == trie.end());
+    while (!expected.empty()) {
+        auto it = expected.begin();
+        std::advance(it, gen() % expected.size());
+        assert(trie.erase(it->first) == 1);
+        expected.erase(it);
+    }
+    assert(trie.empty() && trie.begin() == trie.end());
+}
+
+void TestPathCompression() {
+    CheckAgainstMap<default_trie>(1);
+    CheckAgainstMap<compressed_trie>(2);
+    CheckAgainstMap<compressed_trie>(3);
+
+    compressed_trie trie{{{"whispy", 69},
+                          {"xazax",  1337}}, concat};
+    // splits "whispy" in the middle, and at the end of the new key
+    trie.emplace("whisper", 1);
+    trie.emplace("wh", 2);
+    assert(trie.size() == 4 && trie.at("wh") == 2 && trie.at("whispy") == 69);
+    assert(!trie.contains("whisp") && !trie.contains("w") && !trie.contains("whispyy"));
+    assert(trie.lower_bound("whi")->first == "whisper");
+    assert(trie.lower_bound("whispz")->first == "xazax");
+    assert(trie.upper_bound("whispy")->first == "xazax");
+
+    // erasing re-merges the chain, iterators to the remaining values stay valid
+    auto whispy = trie.find("whispy");
+    trie.erase("whisper");
+    trie.erase("wh");
+    assert(whispy->first == "whispy" && trie.begin() == whispy);
+    compressed_trie copy = trie;
+    assert(copy == trie && copy.at("xazax") == 1337);
+
+    // a leaf child greater than the branching fragment bounds the range
+    default_trie plain{{{"a", 1}, {"ax", 2}}, concat};
+    assert(plain.lower_bound("a\x01")->first == "ax");
+}
+
+void TestImplicitKeys() {
+    CheckAgainstMap<implicit_trie>(4);
+    using plain_implicit = trie<char, int, decltype(concat), std::less, std::basic_string,
+                                std::char_traits, std::allocator, implicit_keys>;
+    CheckAgainstMap<plain_implicit>(5);
+    static_assert(std::is_same_v<implicit_trie::value_type, std::pair<const std::string, int>>);
+
+    implicit_trie trie{{{"key1",    31},
+                        {"key",     5112},
+                        {"fajsjk",  51},
+                        {"hjazuwa", 72}}, concat };
+    auto it = trie.find("key1");
+    assert(it->first == "key1" && it->second == 31);
+    // the proxy refers to the stored value
+    it->second = 32;
+    (*it).second += 1;
+    assert(trie.at("key1") == 33);
+    trie.insert_or_assign("key", 1);
+    assert(trie.at("key") == 1);
+
+    std::string keys;
+    for (const auto& [key, value] : trie)
+        keys += key + ",";
+    assert(keys == "fajsjk,hjazuwa,key,key1,");
+    // elements still bind to value_type
+    for (const implicit_trie::value_type& elem : trie)
+        assert(trie.at(elem.first) == elem.second);
+
+    const implicit_trie copy = trie;
+    assert(copy == trie && copy.begin()->first == "fajsjk");
+    trie.erase(trie.begin());
+    assert(copy != trie && copy < trie);
+
+    // mapped values are never copied on lookup
+    ltr::trie<char, std::unique_ptr<int>, decltype(concat), std::less, std::basic_string,
+              std::char_traits, std::allocator, implicit_keys> nocopy(concat);
+    nocopy.emplace("int1", std::make_unique<int>(1234));
+    assert(*nocopy.begin()->second == 1234 && nocopy.begin()->first == "int1");
+
+    // iterators keep rebuilding keys after the trie holding the concatenation expression by value moved or swapped
+    using by_value = ltr::trie<char, int, std::remove_cvref_t<decltype(concat)>, std::less, std::basic_string,
+                               std::char_traits, std::allocator, implicit_keys>;
+    auto moved = std::make_unique<by_value>(concat);
+    moved->insert({ std::string(100, 'x'), 1 });
+    moved->insert({ "ab", 2 });
+    auto deep = moved->find(std::string(100, 'x'));
+    auto shallow = moved->find("ab");
+    by_value target(std::move(*moved));
+    moved.reset();
+    by_value other(concat);
+    other.swap(target);
+    assert(shallow->first == "ab" && deep->first == std::string(100, 'x') && std::next(shallow) == deep);
+}
+
+void TestArena() {
+    // values with their own allocations make leaks and double frees visible to sanitizers
+    using string_trie = ltr::trie<char, std::string, decltype(concat), std::less, std::basic_string,
+                                  std::char_traits, std::allocator, path_compression>;
+    string_trie trie(concat);
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 1000; ++i)
+            trie.emplace(std::to_string(i * 7919), std::string(40, 'v'));
+        assert(trie.size() == 1000);
+        // erased nodes are recycled by the following inserts
+        for (int i = 0; i < 1000; i += 2)
+            trie.erase(std::to_string(i * 7919));
+        assert(trie.size() == 500);
+    }
+    auto end = trie.end();
+    trie.clear();
+    assert(trie.empty() && end == trie.end());
+    trie.emplace("reused", "after clear");
+    assert(trie.at("reused") == "after clear");
+
+    string_trie other(concat);
+    other.emplace("other", "value");
+    trie.swap(other);
+    assert(trie.at("other") == "value" && other.at("reused") == "after clear");
+    string_trie moved(std::move(other));
+    other = trie;
+    assert(other.at("other") == "value" && moved.size() == 1);
+    moved = std::move(trie);
+    assert(moved.at("other") == "value");
+
+    // deep keys are copied and destroyed without recursion
+    const std::string deep(200000, 'd');
+    default_trie deepTrie(concat);
+    deepTrie.emplace(deep, 1);
+    deepTrie.emplace(deep.substr(0, 1000) + "e", 2);
+    default_trie deepCopy = deepTrie;
+    assert(deepCopy == deepTrie && deepCopy.at(deep) == 1);
+    deepCopy.erase(deep);
+    deepTrie = deepCopy;
+    assert(deepTrie.size() == 1 && deepTrie.begin()->second == 2);
+    deepCopy.clear();
+}
+
+void TestOrderStatistics() {
+    const default_trie trie{{{"apple",   1},
+                             {"apricot", 2},
+                             {"banana",  3},
+                             {"band",    4},
+                             {"bandana", 5},
+                             {"cherry",  6}}, concat};
+    assert(trie.size() == 6);
+    assert(trie.rank("apple") == 0 && trie.rank("b") == 2 && trie.rank("band") == 3 && trie.rank("z") == 6);
+    assert(trie.select(0)->first == "apple" && trie.select(4)->first == "bandana");
+    assert(trie.select(6) == trie.end());
+    assert(trie.count_between("apricot", "bandana") == 3);
+    assert(trie.count_between("b", "c") == 3 && trie.count_between("c", "b") == 0);
+
+    // pages of two elements
+    std::string page;
+    for (auto it = trie.select(2); it != trie.end() && it != trie.select(4); ++it)
+        page += it->first + ",";
+    assert(page == "banana,band,");
+
+    default_trie copy = trie;
+    copy.erase("band");
+    copy["bandanas"] = 7;
+    assert(copy.size() == 6 && copy.rank("bandanas") == 4 && copy.select(3)->first == "bandana");
+    assert(copy != trie);
+    copy.clear();
+    assert(copy.size() == 0 && copy.select(0) == copy.end());
+
+    // wide nodes sum the weights through their index, in every stage
+    std::mt19937 gen(6);
+    default_trie wide(concat);
+    std::map<std::string, int, fragment_order> expected;
+    for (int i = 0; i < 3000; ++i) {
+        std::string key = { static_cast<char>(gen()), static_cast<char>(gen() % 64) };
+        if (gen() % 4 == 0)
+            key.pop_back();
+        wide.emplace(key, i);
+        expected.emplace(key, i);
+        if (i % 3 == 0) {
+            wide.erase(expected.begin()->first);
+            expected.erase(expected.begin());
+        }
+    }
+    default_trie wideCopy = wide;
+    assert(wideCopy.size() == expected.size());
+    std::size_t i = 0;
+    for (const auto& [key, value] : expected) {
+        assert(wide.select(i)->second == value && wideCopy.select(i)->second == value);
+        assert(wide.rank(key) == i && wideCopy.rank(key) == i);
+        ++i;
+    }
+}
+
+// compares the prefix queries to filtering a map, erasing by prefix along the way
+template<typename Trie>
+void CheckPrefixes(unsigned seed) {
+    std::mt19937 gen(seed);
+
+    Trie trie(concat);
+    std::map<std::string, int, fragment_order> expected;
+    for (int i = 0; i < 300; ++i) {
+        std::string key = RandomKey(gen, 6, 'c');
+        trie.emplace(key, i);
+        expected.emplace(key, i);
+    }
+    for (int i = 0; i < 60; ++i) {
+        std::string prefix = gen() % 4 ? RandomKey(gen, 3, 'c') : std::string();
+        std::vector<std::pair<std::string, int>> matching;
+        for (const auto& [key, value] : expected) {
+            if (key.starts_with(prefix))
+                matching.emplace_back(key, value);
+        }
+        auto [first, last] = trie.prefix_range(prefix);
+        assert(std::equal(first, last, matching.begin(), matching.end(), sameElement));
+        assert(trie.count_prefix(prefix) == matching.size());
+        if (matching.empty() && !prefix.empty())
+            assert(first == trie.lower_bound(prefix));
+        if (i % 5 == 0) {
+            assert(trie.erase_prefix(prefix) == matching.size());
+            for (const auto& elem : matching)
+                expected.erase(elem.first);
+            assert(trie.size() == expected.size());
+            assert(std::equal(trie.begin(), trie.end(), expected.begin(), expected.end(), sameElement));
+        }
+    }
+}
+
+void TestPrefixes() {
+    CheckPrefixes<default_trie>(7);
+    CheckPrefixes<compressed_trie>(8);
+    CheckPrefixes<implicit_trie>(9);
+
+    compressed_trie trie{{{"http://a/x", 1},
+                          {"http://a/y", 2},
+                          {"http://b",   3},
+                          {"ftp://c",    4}}, concat};
+    // the prefix ends inside a compressed node
+    auto [first, last] = trie.prefix_range("http:/");
+    assert(first->first == "http://a/x" && last == trie.end() && trie.count_prefix("http:/") == 3);
+    assert(trie.count_prefix("http://a/") == 2 && trie.count_prefix("http://c") == 0);
+    const compressed_trie& ref = trie;
+    assert(ref.prefix_range("ftp").first->second == 4);
+
+    auto ftp = trie.find("ftp://c");
+    assert(trie.erase_prefix("http://a") == 2 && trie.size() == 2);
+    assert(ftp->second == 4 && !trie.contains("http://a/y") && trie.at("http://b") == 3);
+    assert(trie.erase_prefix("https") == 0);
+    assert(trie.erase_prefix("") == 2 && trie.empty());
+}
+
+// range inserts append sorted runs and fall back to regular inserts for the rest
+template<typename Trie>
+void CheckBulkLoad(unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<std::pair<std::string, int>> elems;
+    for (int i = 0; i < 500; ++i) {
+        std::string key = RandomKey(gen, 6, 'd');
+        elems.emplace_back(key, i);
+    }
+    std::map<std::string, int, fragment_order> expected(elems.begin(), elems.end());
+
+    // sorted unique input
+    const Trie sorted(concat, expected.begin(), expected.end());
+    assert(sorted.size() == expected.size());
+    assert(std::equal(sorted.begin(), sorted.end(), expected.begin(), expected.end(), sameElement));
+
+    // unsorted input with duplicates keeps the first value of a key, like emplace
+    Trie unsorted(concat, elems.begin(), elems.end());
+    assert(unsorted == sorted);
+
+    // sorted runs appended to a trie which already has elements, partly greater ones
+    Trie runs(concat);
+    runs.insert(std::next(expected.begin(), expected.size() / 2), expected.end());
+    runs.insert(expected.begin(), std::next(expected.begin(), expected.size() / 2));
+    runs.insert(expected.begin(), expected.end());
+    assert(runs == sorted);
+    for (const auto& [key, value] : expected)
+        assert(runs.at(key) == value && runs.rank(key) == sorted.rank(key));
+}
+
+void TestBulkLoad() {
+    CheckBulkLoad<default_trie>(10);
+    CheckBulkLoad<compressed_trie>(11);
+    CheckBulkLoad<implicit_trie>(12);
+
+    // keys being prefixes of the previous one or branching inside compressed nodes
+    compressed_trie trie{{{"abc",    1},
+                          {"abcdef", 2},
+                          {"abd",    3},
+                          {"ab",     4},
+                          {"abcdef", 5},
+                          {"b",      6}}, concat};
+    assert(trie.size() == 5 && trie.at("abcdef") == 2 && trie.at("ab") == 4);
+    assert(trie.begin()->first == "ab" && trie.select(4)->first == "b");
+}
+
+void TestBatchedLookup() {
+    std::mt19937 gen(13);
+    std::vector<std::string> keys;
+    for (int i = 0; i < 200; ++i) {
+        std::string key = RandomKey(gen, 5, 'e');
+        keys.push_back(key);
+    }
+    default_trie trie(concat);
+    compressed_trie compressed(concat);
+    for (std::size_t i = 0; i < keys.size(); i += 2) {
+        trie.emplace(keys[i], static_cast<int>(i));
+        compressed.emplace(keys[i], static_cast<int>(i));
+    }
+
+    // more keys than a group holds, half of them missing
+    std::vector<default_trie::iterator> found;
+    trie.find_many(keys, std::back_inserter(found));
+    std::vector<compressed_trie::const_iterator> compressedFound(keys.size());
+    std::as_const(compressed).find_many(keys, compressedFound.begin());
+    std::vector<char> contained;
+    compressed.contains_many(keys, std::back_inserter(contained));
+    assert(found.size() == keys.size() && contained.size() == keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        assert(found[i] == trie.find(keys[i]) && compressedFound[i] == std::as_const(compressed).find(keys[i]));
+        assert(static_cast<bool>(contained[i]) == trie.contains(keys[i]));
+    }
+
+    // fragment ranges other than key_type work too
+    std::vector<std::string_view> views = { "whis", "whispy", "xazax", "x", "xazaxx" };
+    compressed_trie small{{{"whispy", 69},
+                           {"xazax",  1337}}, concat};
+    bool expected[] = { false, true, true, false, false };
+    bool result[5];
+    small.contains_many(views, result);
+    assert(std::equal(result, result + 5, expected));
+}
+
+void TestChildSearch() {
+    // sibling counts across the sorted stage, where the keys are searched a vector block at a time
+    std::mt19937 gen(14);
+    for (std::size_t children : { 5, 15, 16, 17, 31, 32, 33, 47, 48 }) {
+        default_trie trie(concat);
+        std::map<std::string, int, fragment_order> expected;
+        while (expected.size() < children) {
+            std::string key = { 'p', static_cast<char>(gen()) };
+            trie.emplace(key, static_cast<int>(expected.size()));
+            expected.emplace(key, static_cast<int>(expected.size()));
+        }
+        for (int c = -128; c < 128; ++c) {
+            std::string key = { 'p', static_cast<char>(c) };
+            auto lower = expected.lower_bound(key);
+            assert(lower == expected.end() ? trie.lower_bound(key) == trie.end() : trie.lower_bound(key)->first == lower->first);
+            assert(trie.contains(key) == expected.contains(key));
+        }
+        // erasing shifts the keys within the blocks
+        for (auto it = expected.begin(); it != expected.end();) {
+            trie.erase(it->first);
+            it = expected.erase(it);
+            if (it != expected.end())
+                ++it;
+        }
+        assert(std::equal(trie.begin(), trie.end(), expected.begin(), expected.end()));
+        for (const auto& [key, value] : expected)
+            assert(trie.at(key) == value);
+    }
+}
+
+template<typename Trie>
+void CheckFragmentRanges() {
+    Trie trie{{{"whispy", 69},
+               {"whisper", 1},
+               {"xazax",  1337}}, concat};
+    const Trie& ctrie = trie;
+    std::string_view view = "whispy";
+    assert(trie.find(view)->second == 69 && ctrie.find(view)->second == 69);
+    assert(trie.contains(std::string_view("whisper")) && !trie.contains(std::string_view("whisp")));
+    assert(trie.count(std::string_view("xazaxx")) == 0 && trie.count(std::string_view("xazax")) == 1);
+    assert(trie.find(std::string_view("xaza")) == trie.end());
+
+    const char buffer[] = { 'x', 'a', 'z', 'a', 'x' };
+    assert(trie.find(std::span<const char>(buffer))->second == 1337);
+    assert(trie.contains(std::array<char, 5>{ 'x', 'a', 'z', 'a', 'x' }));
+    assert(ctrie.find(std::vector<char>{ 'w', 'h', 'i', 's', 'p', 'e', 'r' })->second == 1);
+
+    // a view into a bigger buffer, not null terminated
+    std::string line = "key=whispy;";
+    assert(trie.contains(std::string_view(line).substr(4, 6)));
+
+    // bounds descend the same way
+    assert(trie.lower_bound(std::string_view("whis"))->first == "whisper");
+    assert(ctrie.lower_bound(std::string_view("whispz"))->first == "xazax");
+    assert(trie.upper_bound(std::string_view("whisper"))->first == "whispy");
+    assert(ctrie.upper_bound(std::string_view("xazax")) == ctrie.end());
+    auto [first, last] = trie.equal_range(std::string_view(line).substr(4, 6));
+    assert(first->first == "whispy" && last->first == "xazax");
+    auto [cfirst, clast] = ctrie.equal_range(std::span<const char>(buffer, 3));
+    assert(cfirst == clast && cfirst->first == "xazax");
+}
+
+void TestFragmentRanges() {
+    CheckFragmentRanges<default_trie>();
+    CheckFragmentRanges<compressed_trie>();
+    CheckFragmentRanges<implicit_trie>();
+
+    // transparent comparators keep comparing whole keys for other key types
+    using allow_transparent = trie<char, int, decltype(concat), transparent_compare>;
+    allow_transparent trans{{{"abc",  31},
+                             {"abcd", 5112}}, concat };
+    assert(trans.find(std::string_view("abcd"))->second == 5112 && trans.find(4)->second == 5112);
+    std::size_t res = trans.count<std::string_view, std::less<>>("abc");
+    assert(res == 1);
+}
+
+template<typename Trie>
+void CheckFrozen(unsigned seed) {
+    std::mt19937 gen(seed);
+    Trie trie(concat);
+    std::map<std::string, int, fragment_order> expected;
+    for (int i = 0; i < 2000; ++i) {
+        std::string key = RandomKey(gen, 6, 'e');
+        trie[key] = i;
+        expected[key] = i;
+    }
+
+    const auto frozen = trie.freeze();
+    assert(frozen.size() == expected.size());
+    assert(std::equal(frozen.begin(), frozen.end(), expected.begin(), expected.end(), sameElement));
+    assert(std::equal(frozen.rbegin(), frozen.rend(), expected.rbegin(), expected.rend(), sameElement));
+
+    // lookups of keys in and out of the trie, some of them longer than any key
+    for (int i = 0; i < 2000; ++i) {
+        std::string key = RandomKey(gen, 7, 'f');
+        auto lower = expected.lower_bound(key);
+        auto upper = expected.upper_bound(key);
+        auto frozen_lower = frozen.lower_bound(key);
+        auto frozen_upper = frozen.upper_bound(std::string_view(key));
+        assert(lower == expected.end() ? frozen_lower == frozen.end() : frozen_lower->first == lower->first);
+        assert(upper == expected.end() ? frozen_upper == frozen.end() : frozen_upper->first == upper->first);
+        assert(frozen.contains(key) == (expected.count(key) == 1));
+        assert(frozen.find(key) == (lower == upper ? frozen.end() : frozen_lower));
+        if (lower != upper)
+            assert(frozen.at(key) == lower->second);
+    }
+
+    // the snapshot stays as it was
+    trie.clear();
+    assert(frozen.size() == expected.size() && frozen.begin()->first == expected.begin()->first);
+}
+
+void TestFrozen() {
+    CheckFrozen<default_trie>(15);
+    CheckFrozen<compressed_trie>(16);
+    CheckFrozen<implicit_trie>(17);
+
+    default_trie empty(concat);
+    const frozen_trie<char, int, decltype(concat)> frozen(empty);
+    assert(frozen.empty() && frozen.begin() == frozen.end() && frozen.find("a") == frozen.end());
+    bool thrown = false;
+    try {
+        frozen.at("a");
+    }
+    catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    default_trie trie{{{"abc",  1},
+                       {"abcd", 2},
+                       {"b",    3}}, concat};
+    const auto snapshot = trie.freeze();
+    const frozen_trie<char, int, decltype(concat)> converted(trie);
+    assert(snapshot == converted && snapshot != frozen);
+    assert(std::prev(snapshot.end())->first == "b" && snapshot.upper_bound("abc")->second == 2);
+    assert(snapshot.memory_size() < 3 * sizeof(default_trie::node_type));
+}
+
+void TestImage() {
+    std::mt19937 gen(18);
+    compressed_trie trie(concat);
+    for (int i = 0; i < 3000; ++i) {
+        std::string key = RandomKey(gen, 12, 'z');
+        trie[key] = i;
+    }
+    const auto frozen = trie.freeze();
+    std::ostringstream out;
+    frozen.write(out);
+    const std::string bytes = out.str();
+
+    // viewed from memory, the buffer only has to be aligned
+    std::vector<std::uint64_t> buffer((bytes.size() + 7) / 8);
+    std::memcpy(buffer.data(), bytes.data(), bytes.size());
+    const std::span<const std::byte> image(reinterpret_cast<const std::byte*>(buffer.data()), bytes.size());
+    const frozen_trie<char, int, decltype(concat)> viewed(image, concat);
+    assert(viewed == frozen && viewed.size() == trie.size());
+    assert(std::equal(viewed.begin(), viewed.end(), trie.begin(), trie.end(), sameElement));
+    for (const auto& [key, value] : trie)
+        assert(viewed.at(key) == value && viewed.lower_bound(key)->first == key);
+
+    // viewed from a mapped file
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "ltr_test_image.bin";
+    {
+        std::ofstream file(path, std::ios::binary);
+        frozen.write(file);
+    }
+    {
+        const mapped_file mapped(path.string());
+        const frozen_trie<char, int, decltype(concat)> from_file(mapped.bytes(), concat);
+        assert(from_file == frozen && std::prev(from_file.end())->first == std::prev(trie.end())->first);
+    }
+    std::filesystem::remove(path);
+
+    // images of the empty snapshot, and ones cut short or written for other types
+    std::ostringstream empty_out;
+    frozen_trie<char, int, decltype(concat)>(concat).write(empty_out);
+    std::vector<std::uint64_t> empty_buffer(empty_out.str().size() / 8);
+    std::memcpy(empty_buffer.data(), empty_out.str().data(), empty_out.str().size());
+    const std::span<const std::byte> empty_image(reinterpret_cast<const std::byte*>(empty_buffer.data()), empty_out.str().size());
+    const frozen_trie<char, int, decltype(concat)> empty(empty_image, concat);
+    assert(empty.empty() && empty.begin() == empty.end() && !empty.contains("a"));
+
+    auto rejects = [](auto make) {
+        try {
+            make();
+        }
+        catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    assert(rejects([&] { frozen_trie<char, int, decltype(concat)>(image.first(image.size() / 2), concat); }));
+    assert(rejects([&] { frozen_trie<char, long long, decltype(concat)>(image, concat); }));
+    assert(rejects([&] { frozen_trie<char, int, decltype(concat)>(image.subspan(8), concat); }));
+
+    // images whose rank directory or select samples don't agree with the bits, the header takes 6 words and the
+    // 15 section sizes, followed by the louds words, its rank directory and its samples of the ones
+    auto corrupted = [&](std::size_t section, std::size_t entry, std::uint64_t flip) {
+        std::vector<std::uint64_t> words = buffer;
+        std::size_t start = 6 + 15;
+        for (std::size_t i = 0; i < section; ++i)
+            start += words[6 + i];
+        words[start + entry] ^= flip;
+        const std::span<const std::byte> bad(reinterpret_cast<const std::byte*>(words.data()), bytes.size());
+        return rejects([&] { frozen_trie<char, int, decltype(concat)>(bad, concat); });
+    };
+    assert(corrupted(2, 1, std::uint64_t(1) << 40) && corrupted(2, 1, 1) && corrupted(1, 1, 1) && corrupted(1, buffer[7] - 1, 1));
+
+    // the last one of _tails, the sections 4 to 7, cleared and the total of the rank directory patched to match:
+    // the samples still agree as long as the counts of ones and zeros don't cross a multiple of 512,
+    // but a node is left without its fragments
+    std::vector<std::uint64_t> words = buffer;
+    std::size_t tails = 6 + 15 + buffer[6] + buffer[7] + buffer[8] + buffer[9];
+    std::size_t last = tails + buffer[10] - 1;
+    while (words[last] == 0)
+        --last;
+    words[last] &= ~(std::uint64_t(1) << (63 - std::countl_zero(words[last])));
+    std::uint64_t& total = words[tails + buffer[10] + buffer[11] - 1];
+    assert(total % 512 != 1 && (words[4] - total) % 512 != 0);
+    --total;
+    const std::span<const std::byte> torn(reinterpret_cast<const std::byte*>(words.data()), bytes.size());
+    assert(rejects([&] { frozen_trie<char, int, decltype(concat)>(torn, concat); }));
+}
+
+void TestJournal() {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "ltr_test_journal.bin";
+    std::filesystem::remove(path);
+    std::mt19937 gen(19);
+    std::map<std::string, int, fragment_order> expected;
+    {
+        compressed_trie trie(concat);
+        journal<compressed_trie> log(trie, path.string(), 16);
+        for (int i = 0; i < 3000; ++i) {
+            std::string key = RandomKey(gen, 5, 'f');
+            switch (gen() % 8) {
+            case 0:
+                assert(log.erase(key) == expected.erase(key));
+                break;
+            case 1:
+                log.insert_or_assign(key, i);
+                expected[key] = i;
+                break;
+            default:
+                assert(log.insert({ key, i }).second == expected.emplace(key, i).second);
+            }
+            if (i == 1000) {
+                log.clear();
+                expected.clear();
+            }
+        }
+        assert(log.pending() < 16);
+        log.commit();
+        assert(log.pending() == 0);
+        assert(std::equal(trie.begin(), trie.end(), expected.begin(), expected.end(), sameElement));
+    }
+
+    // replayed after a crash tore the last record
+    {
+        std::ofstream torn(path, std::ios::binary | std::ios::app);
+        const char record[] = { 1, 5, 'a', 'b' };
+        torn.write(record, sizeof(record));
+    }
+    const std::uintmax_t size = std::filesystem::file_size(path);
+    {
+        compressed_trie trie(concat);
+        journal<compressed_trie> log(trie, path.string());
+        assert(std::filesystem::file_size(path) == size - 4);
+        assert(std::equal(trie.begin(), trie.end(), expected.begin(), expected.end(), sameElement));
+
+        // a compact that can't create its file leaves the journal appending to the old one
+        std::filesystem::create_directories(path.string() + ".compact/blocker");
+        bool failed = false;
+        try {
+            log.compact();
+        }
+        catch (const std::runtime_error&) {
+            failed = true;
+        }
+        assert(failed && std::filesystem::file_size(path) == size - 4);
+        std::filesystem::remove_all(path.string() + ".compact");
+
+        // folded into one record per element, then changed some more
+        log.compact();
+        assert(std::filesystem::file_size(path) < size);
+        log.insert_or_assign("zz", 7);
+        log.erase(expected.begin()->first);
+        expected["zz"] = 7;
+        expected.erase(expected.begin());
+    }
+    {
+        compressed_trie trie(concat);
+        journal<compressed_trie> log(trie, path.string(), 1000);
+        assert(std::equal(trie.begin(), trie.end(), expected.begin(), expected.end(), sameElement));
+#ifndef _WIN32
+        // a group cut short by a write error is cut off the file again and written whole by the next commit,
+        // a file size limit just past the committed records makes the write fail part way
+        for (int i = 0; i < 200; ++i) {
+            log.insert({ "short" + std::to_string(i), i });
+            expected.emplace("short" + std::to_string(i), i);
+        }
+        const std::uintmax_t committed = std::filesystem::file_size(path);
+        rlimit unlimited;
+        getrlimit(RLIMIT_FSIZE, &unlimited);
+        rlimit limited = unlimited;
+        limited.rlim_cur = committed + 100;
+        auto handler = std::signal(SIGXFSZ, SIG_IGN);
+        setrlimit(RLIMIT_FSIZE, &limited);
+        bool cut = false;
+        try {
+            log.commit();
+        }
+        catch (const std::runtime_error&) {
+            cut = true;
+        }
+        setrlimit(RLIMIT_FSIZE, &unlimited);
+        std::signal(SIGXFSZ, handler);
+        assert(cut && log.pending() == 200 && std::filesystem::file_size(path) == committed);
+        log.commit();
+        log.insert_or_assign("zz", 8);
+        expected["zz"] = 8;
+#endif
+    }
+    {
+        compressed_trie trie(concat);
+        journal<compressed_trie> log(trie, path.string());
+        assert(std::equal(trie.begin(), trie.end(), expected.begin(), expected.end(), sameElement));
+    }
+
+    // journals of other mapped types are rejected
+    bool thrown = false;
+    try {
+        trie<char, long long, decltype(concat)> other(concat);
+        journal<trie<char, long long, decltype(concat)>> log(other, path.string());
+    }
+    catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::filesystem::remove(path);
+}
+
+void TestConcurrentReads() {
+    // every published version maps each key to its length times ten, the writer keeps replacing keys
+    concurrent_trie<compressed_trie> shared(concat);
+    std::atomic<bool> done = false;
+    std::atomic<int> reads = 0;
+    auto reader = [&] {
+        std::mt19937 gen(20);
+        while (!done || reads < 100) {
+            auto trie = shared.read();
+            std::size_t count = 0;
+            for (const auto& [key, value] : *trie) {
+                assert(value == static_cast<int>(key.size()) * 10);
+                ++count;
+            }
+            assert(count == trie->size());
+            std::string probe(1 + gen() % 4, 'a');
+            auto found = trie->find(probe);
+            assert(found == trie->end() || found->second == static_cast<int>(probe.size()) * 10);
+            ++reads;
+        }
+    };
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++i)
+        readers.emplace_back(reader);
+
+    std::mt19937 gen(21);
+    std::map<std::string, int, fragment_order> expected;
+    for (int i = 0; i < 4000; ++i) {
+        std::string key = RandomKey(gen, 5, 'd');
+        int value = static_cast<int>(key.size()) * 10;
+        if (gen() % 3 == 0)
+            assert(shared.erase(key) == expected.erase(key));
+        else if (gen() % 2)
+            assert(shared.insert({ key, value }) == expected.emplace(key, value).second);
+        else {
+            shared.insert_or_assign(key, value);
+            expected[key] = value;
+        }
+        if (i % 50 == 0)
+            shared.publish();
+        if (i == 2000) {
+            shared.clear();
+            expected.clear();
+        }
+    }
+    shared.publish();
+    done = true;
+    for (std::thread& thread : readers)
+        thread.join();
+
+    auto trie = shared.read();
+    assert(std::equal(trie->begin(), trie->end(), expected.begin(), expected.end(), sameElement));
+    assert(shared.unpublished() == *trie);
+}
+
+void TestOptimisticLockCoupling() {
+    // threads insert overlapping key sets and look up each other's keys meanwhile
+    using shared_trie = olc_trie<char, int, decltype(concat)>;
+    shared_trie trie(concat);
+    const int threads = 4;
+    std::vector<std::vector<std::string>> keys(threads);
+    std::mt19937 gen(22);
+    for (std::vector<std::string>& set : keys) {
+        for (int i = 0; i < 4000; ++i) {
+            std::string key = RandomKey(gen, 6, 'h');
+            set.push_back(key);
+        }
+    }
+    std::atomic<std::size_t> inserted = 0;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; ++t) {
+        writers.emplace_back([&, t] {
+            std::size_t count = 0;
+            const std::vector<std::string>& other = keys[(t + 1) % threads];
+            for (std::size_t i = 0; i < keys[t].size(); ++i) {
+                count += trie.try_emplace(keys[t][i], static_cast<int>(keys[t][i].size()));
+                const int* found = trie.find(other[i]);
+                assert(!found || *found == static_cast<int>(other[i].size()));
+            }
+            inserted += count;
+        });
+    }
+    // children shifted in place meanwhile are still visited once each, in order
+    std::atomic<int> writing = threads;
+    std::thread walker([&] {
+        while (writing > 0) {
+            std::string last;
+            trie.for_each([&](const std::string& key, int value) {
+                assert(last.empty() || fragment_order()(last, key));
+                assert(value == static_cast<int>(key.size()));
+                last = key;
+            });
+        }
+    });
+    for (std::thread& thread : writers) {
+        thread.join();
+        --writing;
+    }
+    walker.join();
+
+    // every key was inserted by exactly one thread
+    std::map<std::string, int, fragment_order> expected;
+    for (const std::vector<std::string>& set : keys) {
+        for (const std::string& key : set)
+            expected.emplace(key, static_cast<int>(key.size()));
+    }
+    assert(inserted == expected.size() && trie.size() == expected.size());
+    auto it = expected.begin();
+    trie.for_each([&](const std::string& key, int value) {
+        assert(it != expected.end() && it->first == key && it->second == value);
+        ++it;
+    });
+    assert(it == expected.end());
+    assert(!trie.try_insert({ expected.begin()->first, 0 }) && *trie.find(expected.begin()->first) != 0);
+    assert(!trie.contains("zz") && trie.try_insert({ "zz", 0 }) && trie.contains("zz"));
+}
+
+template<typename Trie>
+void CheckParallelInsert(unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<std::pair<std::string, int>> elems;
+    for (int i = 0; i < 5000; ++i) {
+        std::string key = RandomKey(gen, 6, 'p');
+        elems.emplace_back(key, i);
+    }
+
+    // matches the sequential range insertion, first value of a key wins
+    Trie sequential(concat, elems.begin(), elems.end());
+    Trie parallel(concat);
+    parallel.parallel_insert(elems.begin(), elems.end(), 4);
+    assert(parallel == sequential && parallel.size() == sequential.size());
+    for (const auto& [key, value] : sequential)
+        assert(parallel.at(key) == value && parallel.rank(key) == sequential.rank(key));
+
+    // into a trie which has elements already, some of them in the same partitions
+    Trie half(concat, elems.begin(), elems.begin() + elems.size() / 2);
+    half.parallel_insert(elems.begin() + elems.size() / 4, elems.end(), 3);
+    assert(half == sequential);
+    half.erase(elems.front().first);
+    half.insert(elems.front());
+    assert(half == sequential && half.select(half.size() / 2)->first == sequential.select(half.size() / 2)->first);
+}
+
+void TestParallelInsert() {
+    CheckParallelInsert<default_trie>(23);
+    CheckParallelInsert<compressed_trie>(24);
+    CheckParallelInsert<implicit_trie>(25);
+
+    // a single partition falls back to insert
+    default_trie trie(concat);
+    std::vector<std::pair<std::string, int>> same = { { "ab", 1 }, { "a", 2 }, { "ab", 3 } };
+    trie.parallel_insert(same.begin(), same.end());
+    assert(trie.size() == 2 && trie.at("ab") == 1);
+    std::vector<std::pair<std::string, int>> more = { { "z", 0 }, { "y", 0 }, { "ac", 0 } };
+    trie.parallel_insert(more.begin(), more.end(), 2);
+    assert(trie.size() == 5 && trie.begin()->first == "a" && trie.rank("z") == 4);
+}
+
+template<typename Trie>
+void CheckParallelTraversal(unsigned seed) {
+    std::mt19937 gen(seed);
+    Trie trie(concat);
+    for (int i = 0; i < 20000; ++i) {
+        std::string key = RandomKey(gen, 8, 'h');
+        trie.insert({ key, i });
+    }
+    long long sum = 0;
+    std::size_t length = 0;
+    for (const auto& [key, value] : trie) {
+        sum += value;
+        length += key.size();
+    }
+
+    // every element is visited exactly once, whatever the number of threads
+    for (std::size_t threads : { 1, 3, 8 }) {
+        std::atomic<long long> visited_sum = 0;
+        std::atomic<std::size_t> visited = 0;
+        std::as_const(trie).parallel_for_each([&](const auto& elem) {
+            visited_sum += elem.second;
+            ++visited;
+        }, threads);
+        assert(visited_sum == sum && visited == trie.size());
+        assert(trie.parallel_reduce(std::size_t(0), std::plus<>(), [](const auto& elem) { return elem.first.size(); }, threads) == length);
+    }
+
+    // mapped values can be changed, elements below a prefix only
+    trie.parallel_for_each([](auto&& elem) { elem.second *= 2; }, 4);
+    assert(trie.parallel_reduce(0ll, std::plus<>(), [](const auto& elem) { return static_cast<long long>(elem.second); }, 4) == 2 * sum);
+    std::atomic<std::size_t> below = 0;
+    trie.parallel_for_each("ab", [&](const auto& elem) {
+        assert(elem.first.compare(0, 2, "ab") == 0);
+        ++below;
+    }, 4);
+    assert(below == trie.count_prefix("ab"));
+    assert(trie.parallel_reduce("abc", std::size_t(0), std::plus<>(), [](const auto&) { return std::size_t(1); }, 2) == trie.count_prefix("abc"));
+    assert(trie.parallel_reduce("zz", 7, std::plus<>(), [](const auto&) { return 1; }) == 7);
+}
+
+void TestParallelTraversal() {
+    CheckParallelTraversal<default_trie>(26);
+    CheckParallelTraversal<compressed_trie>(27);
+    CheckParallelTraversal<implicit_trie>(28);
+
+    // the first exception thrown is rethrown once every thread stopped
+    default_trie trie(concat);
+    for (int i = 0; i < 5000; ++i)
+        trie.insert({ std::to_string(i), i });
+    bool thrown = false;
+    try {
+        trie.parallel_for_each([](const auto& elem) {
+            if (elem.second == 4321)
+                throw std::runtime_error("stop");
+        }, 4);
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+// neither movable nor copyable, so it can only change tries through node handles and merge
+struct Pinned {
+    explicit Pinned(int value) : value(value), self(this) {}
+    Pinned(const Pinned& other) = delete;
+    Pinned& operator=(const Pinned& other) = delete;
+
+    int value;
+    const Pinned* self;
+};
+
+template<typename Trie>
+void CheckMerge(unsigned seed) {
+    std::mt19937 gen(seed);
+    auto random_trie = [&](int count, int offset) {
+        Trie trie(concat);
+        for (int i = 0; i < count; ++i) {
+            std::string key = RandomKey(gen, 7, 'f');
+            trie.insert({ key, offset + i });
+        }
+        return trie;
+    };
+
+    // elements of the source whose key is in the trie stay in the source, like std::map::merge
+    Trie trie = random_trie(3000, 0);
+    Trie source = random_trie(3000, 10000);
+    std::map<std::string, int> merged(trie.begin(), trie.end());
+    std::map<std::string, int> left;
+    for (const auto& [key, value] : source) {
+        if (!merged.emplace(key, value).second)
+            left.emplace(key, value);
+    }
+    trie.merge(source);
+    assert(trie.size() == merged.size() && source.size() == left.size());
+    assert(std::equal(trie.begin(), trie.end(), merged.begin(), merged.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first == rhs.first && lhs.second == rhs.second;
+    }));
+    assert(std::equal(source.begin(), source.end(), left.begin(), left.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first == rhs.first && lhs.second == rhs.second;
+    }));
+    for (const auto& [key, value] : merged)
+        assert(trie.rank(key) == static_cast<std::size_t>(std::distance(merged.begin(), merged.find(key))));
+
+    // relinked nodes outlive the source, and are recycled by the trie
+    {
+        Trie copy = source;
+        source = Trie(concat);
+        source.merge(std::move(copy));
+        assert(source.size() == left.size());
+    }
+    Trie more = random_trie(500, 20000);
+    trie.merge(more);
+    more.clear();
+    for (const auto& [key, value] : merged) {
+        if (value % 3 == 0)
+            trie.erase(key);
+    }
+    for (int i = 0; i < 300; ++i)
+        trie.insert({ "g" + std::to_string(i), i });
+    Trie copy = trie;
+    assert(copy == trie);
+
+    // the other way around, the trie goes away first
+    Trie back = random_trie(1000, 0);
+    {
+        Trie front = random_trie(1000, 0);
+        back.merge(front);
+        front.merge(back);
+        assert(back.empty() || front.size() >= back.size());
+        back.merge(front);
+    }
+    assert(!back.empty() && back.select(back.size() - 1) != back.end());
+}
+
+void TestMerge() {
+    CheckMerge<default_trie>(29);
+    CheckMerge<compressed_trie>(30);
+    CheckMerge<implicit_trie>(31);
+
+    // values relinked in place of inner nodes, and merging into itself or from an empty trie
+    compressed_trie trie{ { { "abcdef", 1 }, { "abcxyz", 2 } }, concat };
+    compressed_trie source{ { { "abc", 3 }, { "abcdef", 4 }, { "abcdefgh", 5 }, { "b", 6 } }, concat };
+    auto relinked = source.find("abc");
+    trie.merge(source);
+    assert(trie.find("abc") == relinked && relinked->second == 3);
+    assert(trie.size() == 5 && trie.at("abc") == 3 && trie.at("abcdef") == 1 && trie.at("abcdefgh") == 5 && trie.at("b") == 6);
+    assert(source.size() == 1 && source.at("abcdef") == 4 && source.count_prefix("abc") == 1);
+    trie.merge(trie);
+    trie.merge(compressed_trie(concat));
+    assert(trie.size() == 5 && trie.rank("b") == 4);
+
+    // elements are relinked, an inner node taking over the node of "a" and a leaf moving below it
+    ltr::trie<char, Pinned, decltype(concat)> pinned(concat);
+    pinned.try_emplace("ab", 1);
+    ltr::trie<char, Pinned, decltype(concat)> other(concat);
+    other.try_emplace("a", 2);
+    other.try_emplace("abc", 3);
+    const Pinned* address = &other.at("a");
+    pinned.merge(other);
+    assert(other.empty() && pinned.size() == 3 && pinned.rank("abc") == 2);
+    assert(&pinned.at("a") == address && address->self == address && address->value == 2);
+}
+
+template<typename Trie>
+void CheckNodeHandles() {
+    Trie trie(concat);
+    for (const char* key : { "a", "ab", "abc", "abd", "b", "ba", "bcdef" })
+        trie.try_emplace(key, static_cast<int>(std::strlen(key)));
+
+    // a leaf, an inner node and the last key of a compressed branch
+    for (const char* key : { "abd", "ab", "bcdef" }) {
+        typename Trie::node_handle handle = trie.extract(key);
+        assert(handle && handle.key() == key && handle.mapped() == static_cast<int>(std::strlen(key)));
+        assert(!trie.contains(key) && trie.extract(key).empty());
+        handle.key() = std::string(key) + "!";
+        auto result = trie.insert(std::move(handle));
+        assert(result.inserted && !result.node && result.position->first == std::string(key) + "!");
+    }
+    assert(trie.size() == 7 && trie.rank("ab!") == 1 && trie.count_prefix("ab") == 3 && trie.select(6)->first == "bcdef!");
+
+    // a taken key gives the handle back, handles move between tries and outlive theirs
+    typename Trie::node_handle handle = trie.extract(trie.find("a"));
+    handle.key() = "abc";
+    auto result = trie.insert(std::move(handle));
+    assert(!result.inserted && result.node && result.position->first == "abc" && result.node.mapped() == 1);
+    {
+        Trie other(concat);
+        other.insert(std::move(result.node));
+        handle = other.extract(other.begin());
+        assert(other.empty() && trie.size() == 6);
+    }
+    assert(handle.key() == "abc" && trie.insert(typename Trie::node_handle()).position == trie.end());
+    handle.key() = "c";
+    assert(trie.insert(std::move(handle)).inserted && trie.size() == 7 && trie.at("c") == 1);
+    Trie copy(trie);
+    for (auto it = copy.begin(); it != copy.end();)
+        trie.insert(copy.extract(it++));
+    assert(copy.empty() && trie.size() == 7);
+    while (!trie.empty())
+        copy.insert(trie.extract(trie.begin()));
+    assert(trie.empty() && copy.size() == 7 && copy.at("bcdef!") == 5);
+}
+
+void TestNodeHandles() {
+    CheckNodeHandles<default_trie>();
+    CheckNodeHandles<compressed_trie>();
+    CheckNodeHandles<implicit_trie>();
+
+    // the element itself never moves
+    trie<char, Pinned, decltype(concat)> pinned(concat);
+    pinned.try_emplace("key", 5);
+    const Pinned* address = &pinned.at("key");
+    auto handle = pinned.extract("key");
+    handle.key() = "other";
+    pinned.insert(std::move(handle));
+    assert(&pinned.at("other") == address && address->self == address && address->value == 5);
+}
+
+template<typename Trie>
+void CheckHintedInsert(unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<std::string> keys;
+    for (int i = 0; i < 2000; ++i) {
+        std::string key = RandomKey(gen, 6, 'e');
+        keys.push_back(key);
+    }
+
+    // any hint gives the same trie, good ones only save work
+    Trie plain(concat);
+    for (std::size_t i = 0; i < keys.size(); ++i)
+        plain.emplace(keys[i], static_cast<int>(i));
+    Trie near(concat), far(concat), ends(concat);
+    typename Trie::iterator last = near.end();
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        last = near.emplace_hint(last, keys[i], static_cast<int>(i));
+        assert(last->first == keys[i]);
+        typename Trie::iterator placed = far.insert(far.begin(), typename Trie::value_type(keys[i], static_cast<int>(i)));
+        assert(placed->first == keys[i] && placed->second == plain.at(keys[i]));
+        ends.insert(ends.cend(), std::make_pair(keys[i], static_cast<int>(i)));
+    }
+    assert(near == plain && far == plain && ends == plain);
+    assert(near.rank(keys.back()) == plain.rank(keys.back()) && ends.select(ends.size() / 3)->first == plain.select(ends.size() / 3)->first);
+
+    // sorted input with the end hint, and hints which share nothing with the key
+    std::vector<std::string> sorted(keys.begin(), keys.end());
+    std::sort(sorted.begin(), sorted.end());
+    Trie appended(concat);
+    for (const std::string& key : sorted)
+        appended.insert(appended.end(), { key, plain.at(key) });
+    assert(appended == plain);
+    const typename Trie::value_type elem("zzz", 1);
+    assert(appended.insert(appended.find("a"), elem)->first == "zzz" && appended.size() == plain.size() + 1);
+    assert(appended.insert(appended.find("zzz"), elem)->second == 1 && appended.size() == plain.size() + 1);
+    try {
+        appended.emplace_hint(appended.begin(), "", 0);
+        assert(false);
+    }
+    catch (const std::invalid_argument&) {}
+
+    // node handles with a hint stay with the caller if the key is taken
+    typename Trie::node_handle handle = appended.extract("zzz");
+    handle.key() = sorted.front();
+    assert(appended.insert(appended.begin(), std::move(handle))->first == sorted.front() && handle && handle.mapped() == 1);
+    handle.key() = "zzzz";
+    assert(appended.insert(appended.end(), std::move(handle))->first == "zzzz" && !handle && appended.rank("zzzz") == plain.size());
+}
+
+void TestHintedInsert() {
+    CheckHintedInsert<default_trie>(32);
+    CheckHintedInsert<compressed_trie>(33);
+    CheckHintedInsert<implicit_trie>(34);
+}
+
+template<typename Trie>
+void CheckPrefixMatch() {
+    Trie routes{ { { "/", 1 }, { "/api", 2 }, { "/api/v1", 3 }, { "/api/v1/users", 4 }, { "/static", 5 } }, concat };
+    assert(routes.longest_prefix_match("/api/v1/users/42")->second == 4);
+    assert(routes.longest_prefix_match("/api/v1/user")->second == 3);
+    assert(routes.longest_prefix_match("/api/v1")->first == "/api/v1");
+    assert(routes.longest_prefix_match("/ap")->second == 1 && routes.longest_prefix_match("/stat")->second == 1);
+    assert(routes.longest_prefix_match("api") == routes.end());
+    assert(std::as_const(routes).longest_prefix_match(std::string_view("/static/logo.png"))->second == 5);
+
+    std::vector<typename Trie::iterator> found;
+    routes.all_prefixes_of("/api/v1/users/42", std::back_inserter(found));
+    assert(found.size() == 4 && found[0]->first == "/" && found[1]->second == 2 && found[3]->first == "/api/v1/users");
+    std::vector<typename Trie::const_iterator> none;
+    std::as_const(routes).all_prefixes_of(std::string_view("static"), std::back_inserter(none));
+    assert(none.empty());
+
+    // matches agree with a lookup of every prefix
+    routes.erase("/api/v1");
+    routes.insert({ "/api/v2", 6 });
+    for (const std::string key : { "/api/v1/users", "/api/v2/x", "/api/v", "/x", "" }) {
+        std::size_t matches = 0;
+        typename Trie::const_iterator longest = routes.cend();
+        for (std::size_t length = 1; length <= key.size(); ++length) {
+            auto it = std::as_const(routes).find(key.substr(0, length));
+            if (it != routes.cend()) {
+                longest = it;
+                ++matches;
+            }
+        }
+        found.clear();
+        routes.all_prefixes_of(key, std::back_inserter(found));
+        assert(found.size() == matches && std::as_const(routes).longest_prefix_match(key) == longest);
+    }
+}
+
+void TestPrefixMatch() {
+    CheckPrefixMatch<default_trie>();
+    CheckPrefixMatch<compressed_trie>();
+    CheckPrefixMatch<implicit_trie>();
+}
+
+template<typename Trie>
+void CheckFuzzySearch(unsigned seed) {
+    Trie words{ { { "cat", 1 }, { "cart", 2 }, { "cast", 3 }, { "dog", 4 }, { "cot", 5 }, { "at", 6 } }, concat };
+    std::vector<std::pair<typename Trie::iterator, std::size_t>> found;
+    words.fuzzy_search("cat", 0, std::back_inserter(found));
+    assert(found.size() == 1 && found[0].first->second == 1 && found[0].second == 0);
+    found.clear();
+    words.fuzzy_search("cat", 1, std::back_inserter(found));
+    assert(found.size() == 5 && found[0].first->first == "at" && found[1].first->first == "cart" && found[4].first->first == "cot");
+    assert(found[0].second == 1 && found[3].second == 0);
+    std::vector<std::pair<typename Trie::const_iterator, std::size_t>> near;
+    std::as_const(words).fuzzy_search(std::string_view("dig"), 1, std::back_inserter(near));
+    assert(near.size() == 1 && near[0].first->second == 4);
+    near.clear();
+    std::as_const(words).fuzzy_search("", 2, std::back_inserter(near));
+    assert(near.size() == 1 && near[0].first->first == "at");
+
+    // matches agree with the distance to every key
+    std::mt19937 gen(seed);
+    Trie trie(concat);
+    for (int i = 0; i < 2000; ++i)
+        trie.insert({ RandomKey(gen, 7, 'd'), i });
+    for (int round = 0; round < 50; ++round) {
+        const std::string query = RandomKey(gen, 7, 'd');
+        const std::size_t max_distance = round % 4;
+        std::vector<std::pair<typename Trie::const_iterator, std::size_t>> expected;
+        for (auto it = trie.cbegin(); it != trie.cend(); ++it) {
+            std::size_t distance = EditDistance(query, it->first);
+            if (distance <= max_distance)
+                expected.emplace_back(it, distance);
+        }
+        near.clear();
+        std::as_const(trie).fuzzy_search(query, max_distance, std::back_inserter(near));
+        assert(near == expected);
+    }
+}
+
+void TestFuzzySearch() {
+    CheckFuzzySearch<default_trie>(35);
+    CheckFuzzySearch<compressed_trie>(36);
+    CheckFuzzySearch<implicit_trie>(37);
+}
+
+template<typename Trie>
+void CheckPatternMatch(unsigned seed) {
+    Trie paths{ { { "user/ann/settings", 1 }, { "user/bob/settings", 2 }, { "user/bob/profile", 3 },
+                  { "user/settings", 4 }, { "users/x/settings", 5 }, { "admin/settings", 6 } }, concat };
+    std::vector<typename Trie::iterator> found;
+    paths.match(pattern("user/*/settings", glob_syntax), std::back_inserter(found));
+    assert(found.size() == 2 && found[0]->second == 1 && found[1]->second == 2);
+    found.clear();
+    paths.match(pattern("user/?[n-o]?/*", glob_syntax), std::back_inserter(found));
+    assert(found.size() == 3 && found[0]->second == 1 && found[1]->second == 3);
+    std::vector<typename Trie::const_iterator> matched;
+    std::as_const(paths).match(pattern("(user|admin)/[^/]*settings"), std::back_inserter(matched));
+    assert(matched.size() == 2 && matched[0]->second == 6 && matched[1]->second == 4);
+    matched.clear();
+    std::as_const(paths).match(pattern("users?/.+/(settings|profile)"), std::back_inserter(matched));
+    assert(matched.size() == 4 && matched[3]->first == "users/x/settings");
+    matched.clear();
+    std::as_const(paths).match(pattern("user/\\*", glob_syntax), std::back_inserter(matched));
+    assert(matched.empty());
+    bool thrown = false;
+    try { pattern("(user"); } catch (const std::invalid_argument&) { thrown = true; }
+    assert(thrown);
+
+    // matches agree with std::regex on every key
+    std::mt19937 gen(seed);
+    Trie trie(concat);
+    for (int i = 0; i < 3000; ++i) {
+        std::string key = RandomKey(gen, 7, 'c');
+        trie.insert({ key, i });
+    }
+    for (const char* source : { "a.*", ".*b", "(ab|c)+", "[^a]?b*c", "a(b|)c.?", "[a-b]+c*", "(a*b)*", "c" }) {
+        const std::regex expected_regex(source);
+        std::vector<typename Trie::const_iterator> expected;
+        for (auto it = trie.cbegin(); it != trie.cend(); ++it) {
+            if (std::regex_match(std::string(it->first), expected_regex))
+                expected.push_back(it);
+        }
+        matched.clear();
+        std::as_const(trie).match(pattern(source), std::back_inserter(matched));
+        assert(matched == expected);
+    }
+}
+
+void TestPatternMatch() {
+    CheckPatternMatch<default_trie>(38);
+    CheckPatternMatch<compressed_trie>(39);
+    CheckPatternMatch<implicit_trie>(40);
+}
+
 // Not intended to be a thorough test, main goal is to try out all overloads
 int main() {
     TestCtors();
@@ -412,5 +1801,28 @@ int main() {
     TestLookup();
     TestObservers();
     TestNonmembers();
+    TestChildIndex();
+    TestPathCompression();
+    TestImplicitKeys();
+    TestArena();
+    TestOrderStatistics();
+    TestPrefixes();
+    TestBulkLoad();
+    TestBatchedLookup();
+    TestChildSearch();
+    TestFragmentRanges();
+    TestFrozen();
+    TestImage();
+    TestJournal();
+    TestConcurrentReads();
+    TestOptimisticLockCoupling();
+    TestParallelInsert();
+    TestParallelTraversal();
+    TestMerge();
+    TestNodeHandles();
+    TestHintedInsert();
+    TestPrefixMatch();
+    TestFuzzySearch();
+    TestPatternMatch();
     return 0;
 }
\ No newline at end of file